@@ -0,0 +1,14 @@
+# Writes the runtime of the C++ backend into a header of the compiler, which
+# pastes it into programs built with --standalone. runtime/ stays the only copy.
+# Usage: cmake -DHEADER=k13rt.hpp -DSOURCE=k13rt.cpp -DOUTPUT=file -P embed.cmake
+file(READ ${HEADER} header)
+file(READ ${SOURCE} source)
+# the header is pasted right in front of the source
+string(REPLACE "#include \"k13rt.hpp\"\n" "" source "${source}")
+file(WRITE ${OUTPUT}
+    "#pragma once\n\n"
+    "// generated from runtime/k13rt.hpp and runtime/k13rt.cpp by runtime/embed.cmake\n\n"
+    "namespace k_13 {\n"
+    "    inline constexpr const char *runtimeHeader = R\"k13rt(${header})k13rt\";\n"
+    "    inline constexpr const char *runtimeSource = R\"k13rt(${source})k13rt\";\n"
+    "} // k_13\n")
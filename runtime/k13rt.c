@@ -0,0 +1,372 @@
+#include "k13rt.h"
+
+#if defined(__linux__) && defined(__x86_64__)
+#define K13RT_FREESTANDING 1
+#else
+#define K13RT_FREESTANDING 0
+#endif
+
+#if K13RT_FREESTANDING
+
+/* raw system calls, the runtime is the only code linked with the program */
+static long k13_syscall(long number, long a, long b, long c, long d, long e, long f) {
+    long result;
+    register long r10 __asm__("r10") = d;
+    register long r8 __asm__("r8") = e;
+    register long r9 __asm__("r9") = f;
+    __asm__ volatile ("syscall"
+                      : "=a"(result)
+                      : "a"(number), "D"(a), "S"(b), "d"(c), "r"(r10), "r"(r8), "r"(r9)
+                      : "rcx", "r11", "memory");
+    return result;
+}
+
+static long k13_read(char *buffer, size_t size) {
+    return k13_syscall(0, 0, (long)buffer, (long)size, 0, 0, 0);
+}
+
+static long k13_write(const char *data, size_t size) {
+    return k13_syscall(1, 1, (long)data, (long)size, 0, 0, 0);
+}
+
+static void k13_exit(int status) {
+    k13_syscall(231, status, 0, 0, 0, 0, 0);
+    for (;;) {
+    }
+}
+
+/* blocks of 64 KiB and more are mapped on their own and grow with mremap,
+   smaller ones come from an arena and are not given back */
+#define K13_LARGE_BLOCK 65536
+#define K13_ARENA_SIZE (1 << 20)
+
+static void *k13_map(size_t size) {
+    long address = k13_syscall(9, 0, (long)size, 3 /* PROT_READ | PROT_WRITE */, 0x22 /* MAP_PRIVATE | MAP_ANONYMOUS */, -1, 0);
+    if (address < 0 && address > -4096) {
+        k13_write("k13: out of memory\n", 19);
+        k13_exit(1);
+    }
+    return (void *)address;
+}
+
+static char *arena;
+static size_t arenaLeft;
+
+static void *k13_alloc(size_t size) {
+    size = (size + 15) & ~(size_t)15;
+    if (size >= K13_LARGE_BLOCK)
+        return k13_map(size);
+    if (size > arenaLeft) {
+        arena = k13_map(K13_ARENA_SIZE);
+        arenaLeft = K13_ARENA_SIZE;
+    }
+    void *block = arena;
+    arena += size;
+    arenaLeft -= size;
+    return block;
+}
+
+static void *k13_realloc(void *block, size_t oldCapacity, size_t size, size_t capacity) {
+    oldCapacity = (oldCapacity + 15) & ~(size_t)15;
+    if (block != NULL && oldCapacity >= K13_LARGE_BLOCK) {
+        long address = k13_syscall(25, (long)block, (long)oldCapacity, (long)((capacity + 15) & ~(size_t)15), 1 /* MREMAP_MAYMOVE */, 0, 0);
+        if (address < 0 && address > -4096) {
+            k13_write("k13: out of memory\n", 19);
+            k13_exit(1);
+        }
+        return (void *)address;
+    }
+    char *moved = k13_alloc(capacity);
+    const char *from = block;
+    for (size_t i = 0; i < size; i++)
+        moved[i] = from[i];
+    return moved;
+}
+
+/* the compiler may emit calls to these even without a libc */
+void *memcpy(void *destination, const void *source, size_t size) {
+    char *to = destination;
+    const char *from = source;
+    while (size--)
+        *to++ = *from++;
+    return destination;
+}
+
+void *memmove(void *destination, const void *source, size_t size) {
+    char *to = destination;
+    const char *from = source;
+    if (to < from) {
+        while (size--)
+            *to++ = *from++;
+    } else {
+        while (size--)
+            to[size] = from[size];
+    }
+    return destination;
+}
+
+void *memset(void *destination, int value, size_t size) {
+    char *to = destination;
+    while (size--)
+        *to++ = (char)value;
+    return destination;
+}
+
+int memcmp(const void *a, const void *b, size_t size) {
+    const unsigned char *x = a;
+    const unsigned char *y = b;
+    for (size_t i = 0; i < size; i++) {
+        if (x[i] != y[i])
+            return x[i] < y[i] ? -1 : 1;
+    }
+    return 0;
+}
+
+void k13_start(void) {
+    k13_main();
+    k13_flush();
+    k13_exit(0);
+}
+
+__asm__(".text\n"
+        ".global _start\n"
+        "_start:\n"
+        "    xor %rbp, %rbp\n"
+        "    and $-16, %rsp\n"
+        "    call k13_start\n"
+        "    hlt\n");
+
+#else
+
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+static long k13_read(char *buffer, size_t size) {
+#ifdef _WIN32
+    return _read(0, buffer, (unsigned)size);
+#else
+    return (long)read(0, buffer, size);
+#endif
+}
+
+static long k13_write(const char *data, size_t size) {
+#ifdef _WIN32
+    return _write(1, data, (unsigned)size);
+#else
+    return (long)write(1, data, size);
+#endif
+}
+
+static void *k13_realloc(void *block, size_t oldCapacity, size_t size, size_t capacity) {
+    (void)oldCapacity;
+    (void)size;
+    void *moved = realloc(block, capacity);
+    if (moved == NULL) {
+        k13_write("k13: out of memory\n", 19);
+        exit(1);
+    }
+    return moved;
+}
+
+int main(void) {
+    k13_main();
+    k13_flush();
+    return 0;
+}
+
+#endif
+
+/* strings */
+
+static void k13_str_reserve(k13_string *s, size_t extra) {
+    if (s->size + extra <= s->capacity)
+        return;
+    size_t capacity = s->capacity * 2;
+    if (capacity < s->size + extra)
+        capacity = s->size + extra;
+    if (capacity < 16)
+        capacity = 16;
+    s->data = k13_realloc(s->data, s->capacity, s->size, capacity);
+    s->capacity = capacity;
+}
+
+void k13_str_clear(k13_string *s) {
+    s->size = 0;
+}
+
+void k13_str_swap(k13_string *a, k13_string *b) {
+    k13_string t = *a;
+    *a = *b;
+    *b = t;
+}
+
+void k13_str_append(k13_string *s, const char *data, size_t size) {
+    k13_str_reserve(s, size);
+    for (size_t i = 0; i < size; i++)
+        s->data[s->size + i] = data[i];
+    s->size += size;
+}
+
+void k13_str_append_cstr(k13_string *s, const char *text) {
+    size_t size = 0;
+    while (text[size] != '\0')
+        size++;
+    k13_str_append(s, text, size);
+}
+
+void k13_str_append_int(k13_string *s, int value) {
+    char digits[12];
+    int position = sizeof(digits);
+    unsigned magnitude = value < 0 ? 0u - (unsigned)value : (unsigned)value;
+    do {
+        digits[--position] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+    if (value < 0)
+        digits[--position] = '-';
+    k13_str_append(s, digits + position, sizeof(digits) - position);
+}
+
+void k13_str_append_bool(k13_string *s, bool value) {
+    k13_str_append(s, value ? "1" : "0", 1);
+}
+
+int k13_str_compare(const char *a, size_t aSize, const char *b, size_t bSize) {
+    size_t size = aSize < bSize ? aSize : bSize;
+    for (size_t i = 0; i < size; i++) {
+        if (a[i] != b[i])
+            return (unsigned char)a[i] < (unsigned char)b[i] ? -1 : 1;
+    }
+    return aSize < bSize ? -1 : aSize > bSize;
+}
+
+/* output, written in large blocks and at exit */
+
+static char output[1 << 16];
+static size_t outputSize;
+
+static void k13_write_all(const char *data, size_t size) {
+    while (size > 0) {
+        long written = k13_write(data, size < (1u << 30) ? size : (1u << 30));
+        if (written <= 0)
+            return;
+        data += written;
+        size -= (size_t)written;
+    }
+}
+
+void k13_flush(void) {
+    k13_write_all(output, outputSize);
+    outputSize = 0;
+}
+
+void k13_put_line(const k13_string *line) {
+    if (line->size + 1 > sizeof(output) - outputSize) {
+        k13_flush();
+        if (line->size + 1 > sizeof(output)) {
+            k13_write_all(line->data, line->size);
+            k13_write_all("\n", 1);
+            return;
+        }
+    }
+    for (size_t i = 0; i < line->size; i++)
+        output[outputSize + i] = line->data[i];
+    outputSize += line->size;
+    output[outputSize++] = '\n';
+}
+
+/* input. After a failure the variables keep their values, a bad number
+   reads as 0 and numbers out of range are clamped. */
+
+static char input[1 << 16];
+static size_t inputPosition;
+static size_t inputSize;
+static bool inputFailed;
+
+static bool k13_available(void) {
+    if (inputPosition < inputSize)
+        return true;
+    long received = k13_read(input, sizeof(input));
+    inputPosition = 0;
+    inputSize = received > 0 ? (size_t)received : 0;
+    return inputSize > 0;
+}
+
+static bool k13_is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+static bool k13_skip_space(void) {
+    while (k13_available() && k13_is_space(input[inputPosition]))
+        inputPosition++;
+    return k13_available();
+}
+
+/* 1 for a number, 0 for bad input, -1 when nothing could be read */
+static int k13_get_number(long long *value) {
+    if (inputFailed || !k13_skip_space()) {
+        inputFailed = true;
+        return -1;
+    }
+    bool negative = input[inputPosition] == '-';
+    if (input[inputPosition] == '-' || input[inputPosition] == '+')
+        inputPosition++;
+    bool digits = false;
+    *value = 0;
+    while (k13_available() && input[inputPosition] >= '0' && input[inputPosition] <= '9') {
+        if (*value <= INT32_MAX)
+            *value = *value * 10 + (input[inputPosition] - '0');
+        inputPosition++;
+        digits = true;
+    }
+    if (!digits) {
+        inputFailed = true;
+        return 0;
+    }
+    if (negative)
+        *value = -*value;
+    return 1;
+}
+
+int16_t k13_get_int16(int16_t old) {
+    long long value;
+    int status = k13_get_number(&value);
+    if (status <= 0)
+        return status < 0 ? old : 0;
+    if (value < INT16_MIN || value > INT16_MAX) {
+        inputFailed = true;
+        return value < 0 ? INT16_MIN : INT16_MAX;
+    }
+    return (int16_t)value;
+}
+
+bool k13_get_bool(bool old) {
+    long long value;
+    int status = k13_get_number(&value);
+    if (status <= 0)
+        return status < 0 ? old : false;
+    if (value != 0 && value != 1)
+        inputFailed = true;
+    return value != 0;
+}
+
+void k13_get_string(k13_string *s) {
+    if (inputFailed || !k13_skip_space()) {
+        inputFailed = true;
+        return;
+    }
+    s->size = 0;
+    while (k13_available()) {
+        size_t start = inputPosition;
+        while (inputPosition < inputSize && !k13_is_space(input[inputPosition]))
+            inputPosition++;
+        k13_str_append(s, input + start, inputPosition - start);
+        if (inputPosition < inputSize)
+            break;
+    }
+}
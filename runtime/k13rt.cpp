@@ -0,0 +1,128 @@
+#include "k13rt.hpp"
+
+#include <charconv>
+#include <cctype>
+
+#ifdef _WIN32
+#include <io.h>
+#define k13_read _read
+#define k13_write _write
+#else
+#include <unistd.h>
+#define k13_read ::read
+#define k13_write ::write
+#endif
+
+std::string k13_scratch;
+k13_writer k13_out;
+k13_reader k13_in;
+
+namespace {
+    void writeAll(const char *data, std::size_t size) {
+        while (size > 0) {
+            auto written = k13_write(1, data, static_cast<unsigned>(size < (1u << 30) ? size : (1u << 30)));
+            if (written <= 0)
+                return;
+            data += written;
+            size -= written;
+        }
+    }
+}
+
+std::size_t k13_format_int(char *buffer, int value) {
+    return static_cast<std::size_t>(std::to_chars(buffer, buffer + 12, value).ptr - buffer);
+}
+
+void k13_writer::flush() {
+    writeAll(buffer, length);
+    length = 0;
+}
+
+void k13_writer::appendLarge(std::string_view v) {
+    flush();
+    if (v.size() > sizeof(buffer)) {
+        writeAll(v.data(), v.size());
+        return;
+    }
+    std::memcpy(buffer, v.data(), v.size());
+    length = v.size();
+}
+
+int16_t k13_reader::int16(int16_t old) {
+    long long value;
+    if (!number(value))
+        return started ? 0 : old;
+    if (value < INT16_MIN || value > INT16_MAX) {
+        failed = true;
+        return value < 0 ? INT16_MIN : INT16_MAX;
+    }
+    return static_cast<int16_t>(value);
+}
+
+bool k13_reader::boolean(bool old) {
+    long long value;
+    if (!number(value))
+        return started ? false : old;
+    if (value != 0 && value != 1)
+        failed = true;
+    return value != 0;
+}
+
+void k13_reader::preload(std::string_view data, bool failed_) {
+    length = data.size() < sizeof(buffer) ? data.size() : sizeof(buffer);
+    std::memcpy(buffer, data.data(), length);
+    position = 0;
+    failed = failed_;
+}
+
+void k13_reader::string(std::string &s) {
+    if (failed || !skipSpace()) {
+        failed = true;
+        return;
+    }
+    s.clear();
+    while (available() && !std::isspace(static_cast<unsigned char>(buffer[position])))
+        s.push_back(buffer[position++]);
+}
+
+bool k13_reader::number(long long &value) {
+    started = false;
+    if (failed || !skipSpace()) {
+        failed = true;
+        return false;
+    }
+    started = true;
+    bool negative = buffer[position] == '-';
+    if (buffer[position] == '-' || buffer[position] == '+')
+        position++;
+    bool digits = false;
+    value = 0;
+    while (available() && buffer[position] >= '0' && buffer[position] <= '9') {
+        if (value <= INT32_MAX)
+            value = value * 10 + (buffer[position] - '0');
+        position++;
+        digits = true;
+    }
+    if (!digits) {
+        failed = true;
+        return false;
+    }
+    if (negative)
+        value = -value;
+    return true;
+}
+
+bool k13_reader::skipSpace() {
+    while (available() && std::isspace(static_cast<unsigned char>(buffer[position])))
+        position++;
+    return available();
+}
+
+bool k13_reader::available() {
+    if (position < length)
+        return true;
+    auto received = k13_read(0, buffer, sizeof(buffer));
+    position = 0;
+    length = received > 0 ? static_cast<std::size_t>(received) : 0;
+    return length > 0;
+}
@@ -0,0 +1,38 @@
+#ifndef K13RT_H
+#define K13RT_H
+
+/* runtime of the C backend: strings, buffered I/O and the program entry.
+   Built freestanding on x86-64 Linux, on top of libc everywhere else. */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct {
+    char *data;
+    size_t size;
+    size_t capacity;
+} k13_string;
+
+/* the generated program, called once by the runtime */
+void k13_main(void);
+
+void k13_str_clear(k13_string *s);
+void k13_str_swap(k13_string *a, k13_string *b);
+void k13_str_append(k13_string *s, const char *data, size_t size);
+void k13_str_append_cstr(k13_string *s, const char *text);
+void k13_str_append_int(k13_string *s, int value);
+void k13_str_append_bool(k13_string *s, bool value);
+/* <0, 0 or >0 like memcmp, shorter string first on a common prefix */
+int k13_str_compare(const char *a, size_t aSize, const char *b, size_t bSize);
+
+/* writes the line and a '\n' to the output buffer */
+void k13_put_line(const k13_string *line);
+void k13_flush(void);
+
+/* same results as operator>> of the C++ backend */
+int16_t k13_get_int16(int16_t old);
+bool k13_get_bool(bool old);
+void k13_get_string(k13_string *s);
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef K13RT_HPP
+#define K13RT_HPP
+
+// runtime of the C++ backend. Generated programs include only this header and
+// link the prebuilt k13rt_cpp library, which also holds the I/O objects. The
+// build precompiles the header, so a program doesn't parse the library headers.
+
+#include <string>
+#include <string_view>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+
+using namespace std::string_view_literals;
+
+// string whose length the optimizer bounded by N, kept without heap memory
+template <std::size_t N>
+class k13_fixed {
+public:
+    k13_fixed &operator=(std::string_view v) { length = 0; append(v); return *this; }
+    void clear() { length = 0; }
+    std::size_t size() const { return length; }
+    // the bound is checked at compile time, a text that still doesn't fit aborts
+    // the program instead of being cut short
+    void append(std::string_view v) {
+        if (v.size() > N - length)
+            std::abort();
+        std::memmove(buffer + length, v.data(), v.size());
+        length += v.size();
+    }
+    void push_back(char c) {
+        if (length == N)
+            std::abort();
+        buffer[length++] = c;
+    }
+    std::string_view view() const { return {buffer, length}; }
+    operator std::string_view() const { return view(); }
+private:
+    char buffer[N > 0 ? N : 1];
+    std::size_t length = 0;
+};
+
+// writes value in decimal to buffer (12 bytes) and returns the number of characters
+std::size_t k13_format_int(char *buffer, int value);
+
+extern std::string k13_scratch;
+
+// the overloads print values the way a stream would: ints in decimal, bools as 1 or 0
+template <class S> inline void k13_append(S &s, const std::string &v) { s.append(v); }
+template <class S> inline void k13_append(S &s, std::string_view v) { s.append(v); }
+template <class S> inline void k13_append(S &s, const char *v) { s.append(std::string_view(v)); }
+template <class S> inline void k13_append(S &s, int v) {
+    char buffer[12];
+    s.append(std::string_view(buffer, k13_format_int(buffer, v)));
+}
+template <class S> inline void k13_append(S &s, bool v) { s.push_back(v ? '1' : '0'); }
+
+// room for extra more characters, at least doubling so repeated appends are amortised
+inline void k13_grow(std::string &s, std::size_t extra) {
+    if (s.size() + extra > s.capacity())
+        s.reserve(s.size() + extra > 2 * s.capacity() ? s.size() + extra : 2 * s.capacity());
+}
+
+// put collects the output and writes it in large blocks, the rest goes out at exit
+class k13_writer {
+public:
+    ~k13_writer() { flush(); }
+    void append(std::string_view v) {
+        if (v.size() > sizeof(buffer) - length) {
+            appendLarge(v);
+            return;
+        }
+        std::memcpy(buffer + length, v.data(), v.size());
+        length += v.size();
+    }
+    void push_back(char c) {
+        if (length == sizeof(buffer))
+            flush();
+        buffer[length++] = c;
+    }
+    void flush();
+private:
+    void appendLarge(std::string_view v);
+    char buffer[1 << 16];
+    std::size_t length = 0;
+};
+
+// get scans a large input buffer and returns the value, so variables are never
+// passed by address. Failures follow operator>>: a bad number reads as 0, out
+// of range numbers are clamped, and once reading has failed the variables keep
+// their values.
+class k13_reader {
+public:
+    int16_t int16(int16_t old);
+    bool boolean(bool old);
+    // input read ahead by the interpreter the program resumes from
+    void preload(std::string_view data, bool failed_);
+    void string(std::string &s);
+private:
+    bool number(long long &value);
+    bool skipSpace();
+    bool available();
+    char buffer[1 << 16];
+    std::size_t position = 0;
+    std::size_t length = 0;
+    bool failed = false;
+    bool started = false;
+};
+
+extern k13_writer k13_out;
+extern k13_reader k13_in;
+
+#endif
@@ -0,0 +1,573 @@
+#include "AsmGenerator.hpp"
+
+namespace {
+    // callee-saved, so values survive the runtime calls of string comparisons.
+    // The last entry is %rax, only used for a left operand taken back from the stack.
+    const char *registers64[] = {"%rbx", "%r12", "%r13", "%r14", "%r15", "%rax"};
+    const char *registers32[] = {"%ebx", "%r12d", "%r13d", "%r14d", "%r15d", "%eax"};
+    const char *registers16[] = {"%bx", "%r12w", "%r13w", "%r14w", "%r15w", "%ax"};
+    const char *registers8[] = {"%bl", "%r12b", "%r13b", "%r14b", "%r15b", "%al"};
+    const int spillRegister = 5;
+
+    // bytes of each kind of variable, strings are a k13_string
+    std::size_t variableSize(k_13::LexemType type) {
+        switch (type) {
+        case k_13::LexemType::BOOL:
+            return 1;
+        case k_13::LexemType::INT:
+            return 2;
+        case k_13::LexemType::NUMBER:
+            return 4;
+        case k_13::LexemType::STRING:
+            return 24;
+        default:
+            return 0;
+        }
+    }
+}
+
+int k_13::AsmGenerator::createAsm(const std::vector<Keyword> &keywords, const std::string &progName, const std::string &outPath, const std::vector<Literal> &literals_) {
+    std::filesystem::path outputFile = outPath;
+    outputFile /= (progName + ".s");
+    std::ofstream file(outputFile);
+
+    if(!file.is_open()) {
+        return -1;
+    }
+    literals = literals_;
+    generate(keywords, file);
+    file.close();
+    return 0;
+}
+
+void k_13::AsmGenerator::generate(const std::vector<Keyword> &keywords, std::ostream &file) {
+    variables.clear();
+    collectVariables(keywords);
+    freeRegisters = {4, 3, 2, 1, 0};
+    spilled = 0;
+    labels = 0;
+
+    file << "    .section .rodata\n";
+    for (auto &literal : literals) {
+        file << "k13_lit" << literal.id << ":\n"
+             << "    .ascii " << literal.value << "\n"
+             << "    .set k13_lit" << literal.id << "_size, . - k13_lit" << literal.id << "\n"
+             << "    .byte 0\n";
+    }
+    file << "\n    .bss\n"
+            "    .balign 8\n"
+            "k13_scratch:\n"
+            "    .zero 24\n"
+            "k13_line:\n"
+            "    .zero 24\n";
+    for (auto &var : variables) {
+        file << "    .balign 8\n"
+             << "k13_v_" << var.first << ":\n"
+             << "    .zero " << variableSize(var.second) << "\n";
+    }
+    // five pushes keep %rsp 16 byte aligned for the calls
+    file << "\n    .text\n"
+            "    .globl k13_main\n"
+            "k13_main:\n"
+            "    push %rbx\n"
+            "    push %r12\n"
+            "    push %r13\n"
+            "    push %r14\n"
+            "    push %r15\n";
+    statement_ch(keywords, file);
+    file << "    pop %r15\n"
+            "    pop %r14\n"
+            "    pop %r13\n"
+            "    pop %r12\n"
+            "    pop %rbx\n"
+            "    ret\n"
+            "    .section .note.GNU-stack,\"\",@progbits\n";
+}
+
+void k_13::AsmGenerator::collectVariables(const std::vector<Keyword> &keywords) {
+    for (auto &keyword : keywords) {
+        switch (keyword.keyword) {
+        case LexemType::START:
+            variables.insert(keyword.variables.begin(), keyword.variables.end());
+            collectVariables(keyword.keywords);
+            break;
+        case LexemType::FOR:
+            variables.insert(keyword.variables.begin(), keyword.variables.end());
+            // the counter of a loop may be used without a declaration
+            variables.insert({keyword.label, LexemType::INT});
+            collectVariables(keyword.keywords);
+            break;
+        case LexemType::IF:
+            if (!keyword.comp.empty()) {
+                variables.insert(keyword.comp.front().variables.begin(), keyword.comp.front().variables.end());
+                collectVariables(keyword.comp.front().keywords);
+            }
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void k_13::AsmGenerator::statement_ch(const std::vector<Keyword> &keywords, std::ostream &file) {
+    for (auto &keyword : keywords) {
+        switch (keyword.keyword) {
+        case LexemType::START:
+            compound_gen(keyword, file);
+            break;
+        case LexemType::ASSIGN:
+            assign_gen(keyword, file);
+            break;
+        case LexemType::GET:
+            get_gen(keyword, file);
+            break;
+        case LexemType::PUT:
+            put_gen(keyword, file);
+            break;
+        case LexemType::GOTO:
+            file << "    jmp " << label(keyword.label) << "\n";
+            break;
+        case LexemType::LABEL:
+            file << label(keyword.label) << ":\n";
+            break;
+        case LexemType::IF:
+            if_gen(keyword, file);
+            break;
+        case LexemType::FOR:
+            for_gen(keyword, file);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+// strings of a block start out empty every time it is entered
+void k_13::AsmGenerator::compound_gen(const Keyword &keyword, std::ostream &file) {
+    for (auto &var : keyword.variables) {
+        if (var.second == LexemType::STRING) {
+            file << "    lea " << variable(var.first) << ", %rdi\n";
+            call("k13_str_clear", file);
+        }
+    }
+    statement_ch(keyword.keywords, file);
+}
+
+void k_13::AsmGenerator::assign_gen(const Keyword &keyword, std::ostream &file) {
+    LexemType type = variables.at(keyword.label);
+    if (type == LexemType::STRING) {
+        str_assign_gen(keyword, file);
+        return;
+    }
+    Value value = evaluate(keyword.expression1, file);
+    switch (type) {
+    case LexemType::BOOL:
+        file << "    test " << reg64(value.reg) << ", " << reg64(value.reg) << "\n"
+             << "    setne " << variable(keyword.label) << "\n";
+        break;
+    case LexemType::INT:
+        file << "    mov " << reg16(value.reg) << ", " << variable(keyword.label) << "\n";
+        break;
+    default:
+        file << "    mov " << reg32(value.reg) << ", " << variable(keyword.label) << "\n";
+        break;
+    }
+    release(value.reg);
+}
+
+// same scheme as the other backends: x := x + ... appends in place, a target
+// read anywhere else is built in k13_scratch and swapped in
+void k_13::AsmGenerator::str_assign_gen(const Keyword &keyword, std::ostream &file) {
+    std::vector<std::vector<Lexem>> factors = str_factors(keyword.expression1);
+    std::size_t first = 0;
+    if (factors.size() > 1 && factors.front().size() == 1 && factors.front().front().type == LexemType::IDENTIFIER
+        && factors.front().front().value == keyword.label)
+        first = 1;
+    bool readsTarget = false;
+    for (std::size_t i = first; i < factors.size(); i++) {
+        for (auto &exp : factors[i]) {
+            if (exp.type == LexemType::IDENTIFIER && exp.value == keyword.label)
+                readsTarget = true;
+        }
+    }
+    if (readsTarget)
+        first = 0;
+    std::string target = readsTarget ? "k13_scratch(%rip)" : variable(keyword.label);
+    if (first == 0) {
+        file << "    lea " << target << ", %rdi\n";
+        call("k13_str_clear", file);
+    }
+    for (std::size_t i = first; i < factors.size(); i++)
+        append_gen(target, factors[i], file);
+    if (readsTarget) {
+        file << "    lea " << variable(keyword.label) << ", %rdi\n"
+             << "    lea k13_scratch(%rip), %rsi\n";
+        call("k13_str_swap", file);
+    }
+}
+
+void k_13::AsmGenerator::append_gen(const std::string &target, const std::vector<Lexem> &factor, std::ostream &file) {
+    ExpressionTree parser;
+    append_gen(target, parser.parse(factor), file);
+}
+
+// a concatenation in parentheses appends its operands one after the other
+void k_13::AsmGenerator::append_gen(const std::string &target, const ExpressionNode &node, std::ostream &file) {
+    if (isConcatenation(node)) {
+        for (auto &operand : node.operands)
+            append_gen(target, operand, file);
+        return;
+    }
+    std::string function;
+    if (!ExpressionTree::isLeaf(node)) {
+        if (ExpressionTree::isLogical(node))
+            function = "k13_str_append_bool";
+        else if (ExpressionTree::hasStringLiteral(node))
+            function = "k13_str_append_cstr";
+        else
+            function = "k13_str_append_int";
+    }
+    else {
+        switch (node.lexem.type) {
+        case LexemType::STRING_LITERAL:
+            file << "    lea k13_lit" << node.lexem.value << "(%rip), %rsi\n"
+                 << "    mov $k13_lit" << node.lexem.value << "_size, %rdx\n";
+            function = "k13_str_append";
+            break;
+        case LexemType::IDENTIFIER:
+            switch (variables.at(node.lexem.value)) {
+            case LexemType::STRING:
+                file << "    mov k13_v_" << node.lexem.value << "(%rip), %rsi\n"
+                     << "    mov k13_v_" << node.lexem.value << "+8(%rip), %rdx\n";
+                function = "k13_str_append";
+                break;
+            case LexemType::BOOL:
+                function = "k13_str_append_bool";
+                break;
+            default:
+                function = "k13_str_append_int";
+                break;
+            }
+            break;
+        case LexemType::TRUE:
+        case LexemType::FALSE:
+            function = "k13_str_append_bool";
+            break;
+        default:
+            function = "k13_str_append_int";
+            break;
+        }
+    }
+    if (function != "k13_str_append") {
+        Value value = evaluate(node, file);
+        file << "    mov " << reg64(value.reg) << ", %rsi\n";
+        release(value.reg);
+    }
+    file << "    lea " << target << ", %rdi\n";
+    call(function, file);
+}
+
+void k_13::AsmGenerator::get_gen(const Keyword &keyword, std::ostream &file) {
+    switch (variables.at(keyword.label)) {
+    case LexemType::INT:
+        file << "    movswl " << variable(keyword.label) << ", %edi\n";
+        call("k13_get_int16", file);
+        file << "    mov %ax, " << variable(keyword.label) << "\n";
+        break;
+    case LexemType::BOOL:
+        file << "    movzbl " << variable(keyword.label) << ", %edi\n";
+        call("k13_get_bool", file);
+        file << "    mov %al, " << variable(keyword.label) << "\n";
+        break;
+    case LexemType::STRING:
+        file << "    lea " << variable(keyword.label) << ", %rdi\n";
+        call("k13_get_string", file);
+        break;
+    default:
+        break;
+    }
+}
+
+void k_13::AsmGenerator::put_gen(const Keyword &keyword, std::ostream &file) {
+    file << "    lea k13_line(%rip), %rdi\n";
+    call("k13_str_clear", file);
+    for (auto &factor : str_factors(keyword.expression1))
+        append_gen("k13_line(%rip)", factor, file);
+    file << "    lea k13_line(%rip), %rdi\n";
+    call("k13_put_line", file);
+    if (options.interactive)
+        call("k13_flush", file);
+}
+
+void k_13::AsmGenerator::if_gen(const Keyword &keyword, std::ostream &file) {
+    Value condition = evaluate(keyword.expression1, file);
+    file << "    test " << reg64(condition.reg) << ", " << reg64(condition.reg) << "\n"
+         << "    jnz " << label(keyword.label) << "\n";
+    release(condition.reg);
+    if (!keyword.comp.empty())
+        compound_gen(keyword.comp.front(), file);
+    if (!keyword.label2.empty())
+        file << "    jmp " << label(keyword.label2) << "\n";
+    if (!keyword.label3.empty())
+        file << label(keyword.label3) << ":\n";
+}
+
+// for (v = e1; v < e2; v++), the bound is evaluated before every iteration
+void k_13::AsmGenerator::for_gen(const Keyword &keyword, std::ostream &file) {
+    int loop = labels++;
+    Value start = evaluate(keyword.expression1, file);
+    file << "    mov " << reg16(start.reg) << ", " << variable(keyword.label) << "\n";
+    release(start.reg);
+    file << ".Lfor" << loop << ":\n";
+    Value bound = evaluate(keyword.expression2, file);
+    file << "    movswl " << variable(keyword.label) << ", %eax\n"
+         << "    cmp " << reg32(bound.reg) << ", %eax\n"
+         << "    jge .Lnext" << loop << "\n";
+    release(bound.reg);
+    compound_gen(keyword, file);
+    file << "    incw " << variable(keyword.label) << "\n"
+         << "    jmp .Lfor" << loop << "\n"
+         << ".Lnext" << loop << ":\n";
+}
+
+k_13::AsmGenerator::Value k_13::AsmGenerator::evaluate(const std::vector<Lexem> &expressions, std::ostream &file) {
+    ExpressionTree parser;
+    return evaluate(parser.parse(expressions), file);
+}
+
+// ints are computed in 32 bits like promoted C++ arithmetic, the upper half
+// of the register stays zero so a value can be tested as a whole
+k_13::AsmGenerator::Value k_13::AsmGenerator::evaluate(const ExpressionNode &node, std::ostream &file) {
+    if (ExpressionTree::isLeaf(node))
+        return leaf(node, file);
+    if (node.operands.size() == 1) {
+        Value value = evaluate(node.operands.front(), file);
+        file << "    test " << reg64(value.reg) << ", " << reg64(value.reg) << "\n"
+             << "    sete " << reg8(value.reg) << "\n"
+             << "    movzbl " << reg8(value.reg) << ", " << reg32(value.reg) << "\n";
+        return {value.reg, false};
+    }
+    if (node.lexem.type == LexemType::AND || node.lexem.type == LexemType::OR)
+        return logical(node, file);
+    bool compare = node.lexem.type == LexemType::EQUAL || node.lexem.type == LexemType::NEQUAL
+                   || node.lexem.type == LexemType::LESS || node.lexem.type == LexemType::GREATER;
+    if (compare && (isString(node.operands.front()) || isString(node.operands.back())))
+        return compareStrings(node, file);
+
+    Value left = evaluate(node.operands.front(), file);
+    bool pushed = freeRegisters.empty();
+    if (pushed) {
+        file << "    push " << reg64(left.reg) << "\n";
+        release(left.reg);
+        spilled++;
+    }
+    Value right = evaluate(node.operands.back(), file);
+    bool pointers = left.pointer || right.pointer;
+    if (pushed) {
+        file << "    pop %rax\n";
+        spilled--;
+        combine(node.lexem.type, reg64(spillRegister), reg64(right.reg), pointers, file);
+        file << "    mov %rax, " << reg64(right.reg) << "\n";
+        return {right.reg, pointers && !compare};
+    }
+    combine(node.lexem.type, reg64(left.reg), reg64(right.reg), pointers, file);
+    release(right.reg);
+    return {left.reg, pointers && !compare};
+}
+
+k_13::AsmGenerator::Value k_13::AsmGenerator::leaf(const ExpressionNode &node, std::ostream &file) {
+    int reg = allocate();
+    switch (node.lexem.type) {
+    case LexemType::NUMBER:
+        file << "    mov $" << node.lexem.constant << ", " << reg32(reg) << "\n";
+        break;
+    case LexemType::TRUE:
+        file << "    mov $1, " << reg32(reg) << "\n";
+        break;
+    case LexemType::FALSE:
+        file << "    xor " << reg32(reg) << ", " << reg32(reg) << "\n";
+        break;
+    case LexemType::STRING_LITERAL:
+        file << "    lea k13_lit" << node.lexem.value << "(%rip), " << reg64(reg) << "\n";
+        return {reg, true};
+    case LexemType::IDENTIFIER:
+        switch (variables.at(node.lexem.value)) {
+        case LexemType::BOOL:
+            file << "    movzbl " << variable(node.lexem.value) << ", " << reg32(reg) << "\n";
+            break;
+        case LexemType::INT:
+            file << "    movswl " << variable(node.lexem.value) << ", " << reg32(reg) << "\n";
+            break;
+        default:
+            file << "    mov " << variable(node.lexem.value) << ", " << reg32(reg) << "\n";
+            break;
+        }
+        break;
+    default:
+        break;
+    }
+    return {reg, false};
+}
+
+// && and || skip the right operand like C++
+k_13::AsmGenerator::Value k_13::AsmGenerator::logical(const ExpressionNode &node, std::ostream &file) {
+    int done = labels++;
+    Value left = evaluate(node.operands.front(), file);
+    file << "    test " << reg64(left.reg) << ", " << reg64(left.reg) << "\n"
+         << (node.lexem.type == LexemType::AND ? "    jz" : "    jnz") << " .Lshort" << done << "\n";
+    release(left.reg);
+    Value right = evaluate(node.operands.back(), file);
+    file << "    test " << reg64(right.reg) << ", " << reg64(right.reg) << "\n"
+         << "    setne " << reg8(right.reg) << "\n"
+         << "    movzbl " << reg8(right.reg) << ", " << reg32(right.reg) << "\n"
+         << "    jmp .Ldone" << done << "\n"
+         << ".Lshort" << done << ":\n"
+         << "    mov $" << (node.lexem.type == LexemType::AND ? 0 : 1) << ", " << reg32(right.reg) << "\n"
+         << ".Ldone" << done << ":\n";
+    return {right.reg, false};
+}
+
+k_13::AsmGenerator::Value k_13::AsmGenerator::compareStrings(const ExpressionNode &node, std::ostream &file) {
+    strOperand(node.operands.front(), "%rdi", "%rsi", file);
+    strOperand(node.operands.back(), "%rdx", "%rcx", file);
+    call("k13_str_compare", file);
+    int reg = allocate();
+    file << "    cmp $0, %eax\n";
+    switch (node.lexem.type) {
+    case LexemType::EQUAL: file << "    sete "; break;
+    case LexemType::NEQUAL: file << "    setne "; break;
+    case LexemType::LESS: file << "    setl "; break;
+    default: file << "    setg "; break;
+    }
+    file << reg8(reg) << "\n"
+         << "    movzbl " << reg8(reg) << ", " << reg32(reg) << "\n";
+    return {reg, false};
+}
+
+void k_13::AsmGenerator::combine(LexemType op, const std::string &left, const std::string &right, bool pointers, std::ostream &file) {
+    int leftIndex = 0;
+    int rightIndex = 0;
+    for (int i = 0; i <= spillRegister; i++) {
+        if (left == registers64[i])
+            leftIndex = i;
+        if (right == registers64[i])
+            rightIndex = i;
+    }
+    std::string left32 = reg32(leftIndex);
+    std::string right32 = reg32(rightIndex);
+    switch (op) {
+    case LexemType::ADD:
+        file << "    add " << right32 << ", " << left32 << "\n";
+        break;
+    case LexemType::SUB:
+        file << "    sub " << right32 << ", " << left32 << "\n";
+        break;
+    case LexemType::MUL:
+        file << "    imul " << right32 << ", " << left32 << "\n";
+        break;
+    case LexemType::DIV:
+    case LexemType::MOD:
+        file << "    mov " << left32 << ", %eax\n"
+             << "    cltd\n"
+             << "    idiv " << right32 << "\n"
+             << "    mov " << (op == LexemType::DIV ? "%eax, " : "%edx, ") << left32 << "\n";
+        break;
+    default: {
+        // a literal compares as a pointer, everything else as a signed int
+        if (pointers)
+            file << "    cmp " << right << ", " << left << "\n";
+        else
+            file << "    cmp " << right32 << ", " << left32 << "\n";
+        std::string set;
+        switch (op) {
+        case LexemType::EQUAL: set = "sete"; break;
+        case LexemType::NEQUAL: set = "setne"; break;
+        case LexemType::LESS: set = pointers ? "setb" : "setl"; break;
+        default: set = pointers ? "seta" : "setg"; break;
+        }
+        file << "    " << set << " " << reg8(leftIndex) << "\n"
+             << "    movzbl " << reg8(leftIndex) << ", " << left32 << "\n";
+        break;
+    }
+    }
+}
+
+void k_13::AsmGenerator::strOperand(const ExpressionNode &node, const std::string &data, const std::string &size, std::ostream &file) {
+    if (node.lexem.type == LexemType::STRING_LITERAL)
+        file << "    lea k13_lit" << node.lexem.value << "(%rip), " << data << "\n"
+             << "    mov $k13_lit" << node.lexem.value << "_size, " << size << "\n";
+    else
+        file << "    mov k13_v_" << node.lexem.value << "(%rip), " << data << "\n"
+             << "    mov k13_v_" << node.lexem.value << "+8(%rip), " << size << "\n";
+}
+
+bool k_13::AsmGenerator::isString(const ExpressionNode &node) {
+    return ExpressionTree::isLeaf(node) && node.lexem.type == LexemType::IDENTIFIER
+           && variables.contains(node.lexem.value) && variables.at(node.lexem.value) == LexemType::STRING;
+}
+
+// "+" with a string variable among its operands, a std::string operator+ in C++
+bool k_13::AsmGenerator::isConcatenation(const ExpressionNode &node) {
+    if (node.lexem.type != LexemType::ADD || node.operands.size() != 2)
+        return false;
+    std::vector<std::string> identifiers;
+    ExpressionTree::collectIdentifiers(node, identifiers);
+    for (auto &identifier : identifiers) {
+        if (variables.contains(identifier) && variables.at(identifier) == LexemType::STRING)
+            return true;
+    }
+    return false;
+}
+
+// values pushed in the middle of an expression move %rsp off the 16 byte alignment
+void k_13::AsmGenerator::call(const std::string &function, std::ostream &file) {
+    if (spilled % 2 != 0)
+        file << "    sub $8, %rsp\n";
+    file << "    call " << function << "\n";
+    if (spilled % 2 != 0)
+        file << "    add $8, %rsp\n";
+}
+
+int k_13::AsmGenerator::allocate() {
+    int reg = freeRegisters.back();
+    freeRegisters.pop_back();
+    return reg;
+}
+
+void k_13::AsmGenerator::release(int reg) {
+    if (reg != spillRegister)
+        freeRegisters.push_back(reg);
+}
+
+std::string k_13::AsmGenerator::reg64(int reg) {
+    return registers64[reg];
+}
+
+std::string k_13::AsmGenerator::reg32(int reg) {
+    return registers32[reg];
+}
+
+std::string k_13::AsmGenerator::reg16(int reg) {
+    return registers16[reg];
+}
+
+std::string k_13::AsmGenerator::reg8(int reg) {
+    return registers8[reg];
+}
+
+// splits a string expression at the "+" that concatenate
+std::vector<std::vector<k_13::Lexem>> k_13::AsmGenerator::str_factors(const std::vector<Lexem> &expressions) {
+    std::vector<std::vector<Lexem>> factors(1);
+    int depth = 0;
+    for (auto &exp : expressions) {
+        if (exp.type == LexemType::LPAREN)
+            depth++;
+        else if (exp.type == LexemType::RPAREN)
+            depth--;
+        if (exp.type == LexemType::ADD && depth == 0)
+            factors.emplace_back();
+        else
+            factors.back().push_back(exp);
+    }
+    return factors;
+}
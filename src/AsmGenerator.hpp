@@ -0,0 +1,76 @@
+#pragma once
+
+#include <filesystem>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+
+#include "constants.hpp"
+#include "ExpressionTree.hpp"
+#include "Generator.hpp"
+
+namespace k_13 {
+// x86-64 GNU assembly backend for Linux. Variables live in .bss, expressions
+// are evaluated in callee-saved registers and strings and I/O go through the
+// runtime of the C backend, which also provides _start.
+class AsmGenerator {
+public:
+    AsmGenerator() = default;
+    ~AsmGenerator() = default;
+
+    int createAsm(const std::vector<Keyword> &keywords, const std::string &progName, const std::string &outPath, const std::vector<Literal> &literals_);
+    void setOptions(const GeneratorOptions &options_) { options = options_; }
+
+private:
+    // register holding a value, pointer values come from string literals
+    struct Value {
+        int reg = 0;
+        bool pointer = false;
+    };
+
+    void generate(const std::vector<Keyword> &keywords, std::ostream &file);
+    void collectVariables(const std::vector<Keyword> &keywords);
+    void statement_ch(const std::vector<Keyword> &keywords, std::ostream &file);
+    void compound_gen(const Keyword &keyword, std::ostream &file);
+    void assign_gen(const Keyword &keyword, std::ostream &file);
+    void str_assign_gen(const Keyword &keyword, std::ostream &file);
+    void append_gen(const std::string &target, const std::vector<Lexem> &factor, std::ostream &file);
+    void append_gen(const std::string &target, const ExpressionNode &node, std::ostream &file);
+    void get_gen(const Keyword &keyword, std::ostream &file);
+    void put_gen(const Keyword &keyword, std::ostream &file);
+    void if_gen(const Keyword &keyword, std::ostream &file);
+    void for_gen(const Keyword &keyword, std::ostream &file);
+
+    Value evaluate(const std::vector<Lexem> &expressions, std::ostream &file);
+    Value evaluate(const ExpressionNode &node, std::ostream &file);
+    Value leaf(const ExpressionNode &node, std::ostream &file);
+    Value logical(const ExpressionNode &node, std::ostream &file);
+    Value compareStrings(const ExpressionNode &node, std::ostream &file);
+    void combine(LexemType op, const std::string &left, const std::string &right, bool pointers, std::ostream &file);
+    void strOperand(const ExpressionNode &node, const std::string &data, const std::string &size, std::ostream &file);
+    bool isString(const ExpressionNode &node);
+    bool isConcatenation(const ExpressionNode &node);
+    void call(const std::string &function, std::ostream &file);
+
+    int allocate();
+    void release(int reg);
+    static std::string reg64(int reg);
+    static std::string reg32(int reg);
+    static std::string reg16(int reg);
+    static std::string reg8(int reg);
+    std::string variable(const std::string &name) { return "k13_v_" + name + "(%rip)"; }
+    std::string label(const std::string &name) { return ".Lk13_" + name; }
+    std::vector<std::vector<Lexem>> str_factors(const std::vector<Lexem> &expressions);
+
+    std::vector<Literal> literals;
+    GeneratorOptions options;
+    std::map<std::string, LexemType> variables;
+    // registers not holding a value, values pushed when all of them are in use
+    std::vector<int> freeRegisters;
+    int spilled = 0;
+    int labels = 0;
+};
+
+} // k_13
@@ -0,0 +1,157 @@
+#include "BuildCache.hpp"
+
+#include <fstream>
+#include <random>
+#include <cstdlib>
+#include <algorithm>
+
+std::filesystem::path k_13::BuildCache::defaultDirectory() {
+    if (const char *cache = std::getenv("K13_CACHE_DIR"); cache && *cache)
+        return cache;
+    if (const char *xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg)
+        return std::filesystem::path(xdg) / "k13c";
+#ifdef _WIN32
+    const char *home = std::getenv("LOCALAPPDATA");
+#else
+    const char *home = std::getenv("HOME");
+#endif
+    if (home && *home)
+        return std::filesystem::path(home) / ".cache" / "k13c";
+    return std::filesystem::temp_directory_path() / "k13c";
+}
+
+std::string k_13::BuildCache::toolIdentity(const std::string &path) {
+    std::error_code error;
+    std::filesystem::path tool = std::filesystem::canonical(path, error);
+    if (error)
+        return path;
+    auto size = std::filesystem::file_size(tool, error);
+    auto time = std::filesystem::last_write_time(tool, error);
+    return tool.string() + " " + std::to_string(size) + " " + std::to_string(time.time_since_epoch().count());
+}
+
+bool k_13::BuildCache::fetch(const std::string &key, const std::vector<std::pair<std::string, std::filesystem::path>> &files) {
+    std::error_code error;
+    std::filesystem::path entry = directory / key;
+    for (auto &file : files) {
+        if (!std::filesystem::is_regular_file(entry / file.first, error)) {
+            count(false);
+            return false;
+        }
+    }
+    std::random_device random;
+    for (auto &file : files) {
+        // the file is linked or copied next to its destination and renamed over
+        // it, an entry evicted meanwhile leaves the old destination in place
+        std::filesystem::path staging = file.second;
+        staging += ".tmp-" + std::to_string(random());
+        // a hard link costs nothing, across file systems the file is copied
+        std::filesystem::create_hard_link(entry / file.first, staging, error);
+        if (error && !std::filesystem::copy_file(entry / file.first, staging, std::filesystem::copy_options::overwrite_existing, error)) {
+            std::filesystem::remove(staging, error);
+            count(false);
+            return false;
+        }
+        std::filesystem::rename(staging, file.second, error);
+        if (error) {
+            std::filesystem::remove(staging, error);
+            count(false);
+            return false;
+        }
+    }
+    // the modification time of an entry is its last use
+    std::filesystem::last_write_time(entry, std::filesystem::file_time_type::clock::now(), error);
+    count(true);
+    return true;
+}
+
+int k_13::BuildCache::insert(const std::string &key, const std::vector<std::pair<std::string, std::filesystem::path>> &files) {
+    std::error_code error;
+    std::filesystem::path entry = directory / key;
+    if (std::filesystem::exists(entry, error))
+        return 0;
+    std::random_device random;
+    std::filesystem::path staging = directory / ("tmp-" + key.substr(0, 16) + "-" + std::to_string(random()));
+    std::filesystem::create_directories(staging, error);
+    if (error)
+        return -1;
+    for (auto &file : files) {
+        if (!std::filesystem::copy_file(file.second, staging / file.first, error)) {
+            std::filesystem::remove_all(staging, error);
+            return -1;
+        }
+    }
+    // readers see the whole entry or none of it; when another build inserted
+    // the same key first its entry is kept
+    std::filesystem::rename(staging, entry, error);
+    if (error) {
+        std::filesystem::remove_all(staging, error);
+        return std::filesystem::exists(entry, error) ? 0 : -1;
+    }
+    evict();
+    return 0;
+}
+
+// counters live in the cache, so they add up over all runs. A concurrent
+// update may be lost, the file is never torn.
+void k_13::BuildCache::count(bool hit) {
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    std::ifstream stats(directory / "stats");
+    std::string name;
+    stats >> name >> hits >> name >> misses;
+    if (!stats) {
+        hits = 0;
+        misses = 0;
+    }
+    stats.close();
+    (hit ? hits : misses)++;
+    std::random_device random;
+    std::filesystem::path staging = directory / ("tmp-stats-" + std::to_string(random()));
+    std::ofstream file(staging);
+    file << "hits " << hits << "\nmisses " << misses << "\n";
+    file.close();
+    std::filesystem::rename(staging, directory / "stats", error);
+    if (error)
+        std::filesystem::remove(staging, error);
+}
+
+// build entries and cached front ends share the limit, the least recently
+// used of either kind goes first
+void k_13::BuildCache::evict() {
+    std::error_code error;
+    std::vector<std::pair<std::filesystem::file_time_type, std::pair<std::filesystem::path, std::uintmax_t>>> entries;
+    size = 0;
+    for (auto &entry : std::filesystem::directory_iterator(directory / "frontend", error)) {
+        // files being written are named tmp-*
+        if (!entry.is_regular_file(error) || entry.path().extension() != ".k13f")
+            continue;
+        std::uintmax_t bytes = entry.file_size(error);
+        if (error)
+            continue;
+        entries.push_back({entry.last_write_time(error), {entry.path(), bytes}});
+        size += bytes;
+    }
+    for (auto &entry : std::filesystem::directory_iterator(directory, error)) {
+        std::string name = entry.path().filename().string();
+        // entries are named by a hash, frontend was counted above
+        if (!entry.is_directory(error) || name.size() != 64 || name.find_first_not_of("0123456789abcdef") != std::string::npos)
+            continue;
+        std::uintmax_t bytes = 0;
+        for (auto &file : std::filesystem::directory_iterator(entry.path(), error)) {
+            std::uintmax_t fileSize = file.file_size(error);
+            if (!error)
+                bytes += fileSize;
+        }
+        entries.push_back({entry.last_write_time(error), {entry.path(), bytes}});
+        size += bytes;
+    }
+    std::sort(entries.begin(), entries.end());
+    for (auto &entry : entries) {
+        if (size <= maxBytes)
+            break;
+        std::filesystem::remove_all(entry.second.first, error);
+        size -= entry.second.second;
+        evicted++;
+    }
+}
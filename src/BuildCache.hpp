@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <filesystem>
+
+namespace k_13 {
+// On-disk cache of build outputs. An entry is a directory named by the
+// SHA-256 of everything the outputs depend on. Entries are renamed into place
+// complete, so concurrent builds never see half of one, and the least
+// recently used entries are removed when the cache outgrows its limit.
+class BuildCache {
+public:
+    BuildCache(std::filesystem::path directory_, std::uintmax_t maxBytes_) : directory(std::move(directory_)), maxBytes(maxBytes_) {}
+    ~BuildCache() = default;
+
+    // $K13_CACHE_DIR, else $XDG_CACHE_HOME/k13c, else ~/.cache/k13c
+    static std::filesystem::path defaultDirectory();
+    // path, size and modification time of a tool, changes when it is updated
+    static std::string toolIdentity(const std::string &path);
+
+    // copies (or hard-links) the files of the entry to their destinations,
+    // false on a miss. Hits and misses are counted in the cache.
+    bool fetch(const std::string &key, const std::vector<std::pair<std::string, std::filesystem::path>> &files);
+    // stores the sources under their names in the entry, 0 when it is in the cache afterwards
+    int insert(const std::string &key, const std::vector<std::pair<std::string, std::filesystem::path>> &files);
+
+    // removes the least recently used build entries and cached front ends
+    // until the cache fits its limit
+    void evict();
+
+    std::uint64_t getHits() const { return hits; }
+    std::uint64_t getMisses() const { return misses; }
+    std::uintmax_t getSize() const { return size; }
+    int getEvicted() const { return evicted; }
+
+private:
+    void count(bool hit);
+
+    std::filesystem::path directory;
+    std::uintmax_t maxBytes;
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+    std::uintmax_t size = 0;
+    int evicted = 0;
+};
+
+} // k_13
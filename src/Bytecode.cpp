@@ -0,0 +1,442 @@
+#include "Bytecode.hpp"
+
+int k_13::BytecodeCompiler::compile(const std::vector<Keyword> &keywords, const std::vector<Literal> &literals_, BytecodeProgram &program_) {
+    program = &program_;
+    *program = {};
+    program->interactive = options.interactive;
+    literalIndex.clear();
+    for (auto &literal : literals_) {
+        literalIndex[literal.id] = static_cast<int>(program->literals.size());
+        program->literals.push_back(Generator::decodeLiteral(literal.value));
+    }
+    program->stringRegisters = 2;
+    collectVariables(keywords);
+    nextTemporary = program->intRegisters;
+    labels.clear();
+    pendingJumps.clear();
+    loops = 0;
+    line = 0;
+    error.clear();
+
+    statement_ch(keywords);
+    emit(Opcode::HALT);
+    if (!error.empty())
+        return -1;
+    for (auto &pending : pendingJumps) {
+        auto label = labels.find(pending.second);
+        if (label == labels.end()) {
+            error = "label " + pending.second + " is never placed";
+            return -1;
+        }
+        Instruction &instruction = program->code[pending.first];
+        if (instruction.op == Opcode::JUMP)
+            instruction.a = label->second;
+        else
+            instruction.b = label->second;
+    }
+    return 0;
+}
+
+// every variable keeps its register for the whole run, so goto never skips a
+// declaration. Blocks empty their strings when they are entered.
+void k_13::BytecodeCompiler::collectVariables(const std::vector<Keyword> &keywords) {
+    auto declare = [this](const std::string &name, LexemType type) {
+        if (program->registers.contains(name))
+            return;
+        program->types[name] = type;
+        program->registers[name] = type == LexemType::STRING ? program->stringRegisters++ : program->intRegisters++;
+    };
+    for (auto &keyword : keywords) {
+        switch (keyword.keyword) {
+        case LexemType::START:
+            for (auto &var : keyword.variables)
+                declare(var.first, var.second);
+            collectVariables(keyword.keywords);
+            break;
+        case LexemType::FOR:
+            for (auto &var : keyword.variables)
+                declare(var.first, var.second);
+            // the counter of a loop may be used without a declaration
+            declare(keyword.label, LexemType::INT);
+            collectVariables(keyword.keywords);
+            break;
+        case LexemType::IF:
+            if (!keyword.comp.empty()) {
+                for (auto &var : keyword.comp.front().variables)
+                    declare(var.first, var.second);
+                collectVariables(keyword.comp.front().keywords);
+            }
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void k_13::BytecodeCompiler::statement_ch(const std::vector<Keyword> &keywords) {
+    for (auto &keyword : keywords) {
+        if (!keyword.expression1.empty())
+            line = keyword.expression1.front().line;
+        switch (keyword.keyword) {
+        case LexemType::START:
+            compound_gen(keyword);
+            break;
+        case LexemType::ASSIGN:
+            assign_gen(keyword);
+            break;
+        case LexemType::GET:
+            get_gen(keyword);
+            break;
+        case LexemType::PUT:
+            put_gen(keyword);
+            break;
+        case LexemType::GOTO:
+            jump(Opcode::JUMP, 0, 0, keyword.label);
+            break;
+        case LexemType::LABEL:
+            place(keyword.label);
+            safePoint(keyword.label, 1);
+            break;
+        case LexemType::IF:
+            if_gen(keyword);
+            break;
+        case LexemType::FOR:
+            for_gen(keyword);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void k_13::BytecodeCompiler::compound_gen(const Keyword &keyword) {
+    for (auto &var : keyword.variables) {
+        if (var.second == LexemType::STRING)
+            emit(Opcode::STR_CLEAR, program->registers.at(var.first));
+    }
+    statement_ch(keyword.keywords);
+}
+
+void k_13::BytecodeCompiler::assign_gen(const Keyword &keyword) {
+    LexemType type = program->types.at(keyword.label);
+    if (type == LexemType::STRING) {
+        str_assign_gen(keyword);
+        return;
+    }
+    int target = program->registers.at(keyword.label);
+    int value = expression(keyword.expression1);
+    switch (type) {
+    case LexemType::BOOL:
+        emit(Opcode::TO_BOOL, target, value);
+        break;
+    case LexemType::INT:
+        emit(Opcode::TO_INT16, target, value);
+        break;
+    default:
+        if (value != target)
+            emit(Opcode::MOVE, target, value);
+        break;
+    }
+}
+
+// x := x + ... appends in place. When the target is read anywhere else the
+// value is built in the scratch register and swapped in.
+void k_13::BytecodeCompiler::str_assign_gen(const Keyword &keyword) {
+    std::vector<std::vector<Lexem>> factors = str_factors(keyword.expression1);
+    std::size_t first = 0;
+    if (factors.size() > 1 && factors.front().size() == 1 && factors.front().front().type == LexemType::IDENTIFIER
+        && factors.front().front().value == keyword.label)
+        first = 1;
+    bool readsTarget = false;
+    for (std::size_t i = first; i < factors.size(); i++) {
+        for (auto &exp : factors[i]) {
+            if (exp.type == LexemType::IDENTIFIER && exp.value == keyword.label)
+                readsTarget = true;
+        }
+    }
+    if (readsTarget)
+        first = 0;
+    int target = readsTarget ? scratchRegister : program->registers.at(keyword.label);
+    if (first == 0)
+        emit(Opcode::STR_CLEAR, target);
+    for (std::size_t i = first; i < factors.size(); i++)
+        append_gen(target, factors[i]);
+    if (readsTarget)
+        emit(Opcode::STR_SWAP, program->registers.at(keyword.label), scratchRegister);
+}
+
+void k_13::BytecodeCompiler::append_gen(int target, const std::vector<Lexem> &factor) {
+    ExpressionTree parser;
+    append_gen(target, parser.parse(factor));
+}
+
+// the value is printed as the C++ backend's k13_append overload would. A
+// concatenation in parentheses appends its operands one after the other.
+void k_13::BytecodeCompiler::append_gen(int target, const ExpressionNode &node) {
+    if (isConcatenation(node)) {
+        for (auto &operand : node.operands)
+            append_gen(target, operand);
+        return;
+    }
+    int mark = nextTemporary;
+    if (!ExpressionTree::isLeaf(node)) {
+        int value = expression(node);
+        nextTemporary = mark;
+        if (ExpressionTree::isLogical(node))
+            emit(Opcode::STR_APPEND_BOOL, target, value);
+        else if (ExpressionTree::hasStringLiteral(node))
+            emit(Opcode::STR_APPEND_CSTR, target, value);
+        else
+            emit(Opcode::STR_APPEND_INT, target, value);
+        return;
+    }
+    switch (node.lexem.type) {
+    case LexemType::STRING_LITERAL:
+        emit(Opcode::STR_APPEND_LITERAL, target, literalIndex.at(std::stoi(node.lexem.value)));
+        break;
+    case LexemType::NUMBER:
+        emit(Opcode::STR_APPEND_INT, target, expression(node));
+        nextTemporary = mark;
+        break;
+    case LexemType::TRUE:
+    case LexemType::FALSE:
+        emit(Opcode::STR_APPEND_BOOL, target, expression(node));
+        nextTemporary = mark;
+        break;
+    case LexemType::IDENTIFIER:
+        switch (program->types.at(node.lexem.value)) {
+        case LexemType::STRING:
+            emit(Opcode::STR_APPEND, target, program->registers.at(node.lexem.value));
+            break;
+        case LexemType::BOOL:
+            emit(Opcode::STR_APPEND_BOOL, target, program->registers.at(node.lexem.value));
+            break;
+        default:
+            emit(Opcode::STR_APPEND_INT, target, program->registers.at(node.lexem.value));
+            break;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void k_13::BytecodeCompiler::get_gen(const Keyword &keyword) {
+    int target = program->registers.at(keyword.label);
+    switch (program->types.at(keyword.label)) {
+    case LexemType::INT:
+        emit(Opcode::GET_INT16, target);
+        break;
+    case LexemType::BOOL:
+        emit(Opcode::GET_BOOL, target);
+        break;
+    case LexemType::STRING:
+        emit(Opcode::GET_STRING, target);
+        break;
+    default:
+        break;
+    }
+}
+
+void k_13::BytecodeCompiler::put_gen(const Keyword &keyword) {
+    emit(Opcode::STR_CLEAR, lineRegister);
+    for (auto &factor : str_factors(keyword.expression1))
+        append_gen(lineRegister, factor);
+    emit(Opcode::PUT, lineRegister);
+}
+
+void k_13::BytecodeCompiler::if_gen(const Keyword &keyword) {
+    jump(Opcode::JUMP_NOT_ZERO, expression(keyword.expression1), 0, keyword.label);
+    if (!keyword.comp.empty())
+        compound_gen(keyword.comp.front());
+    if (!keyword.label2.empty())
+        jump(Opcode::JUMP, 0, 0, keyword.label2);
+    if (!keyword.label3.empty())
+        place(keyword.label3);
+}
+
+// for (v = e1; v < e2; v++), the bound is evaluated before every iteration
+void k_13::BytecodeCompiler::for_gen(const Keyword &keyword) {
+    int counter = program->registers.at(keyword.label);
+    emit(Opcode::TO_INT16, counter, expression(keyword.expression1));
+    int condition = static_cast<int>(program->code.size());
+    safePoint("k13_safe_" + std::to_string(loops++), countStatements(keyword.keywords) + 1);
+    int bound = expression(keyword.expression2);
+    int exit = emit(Opcode::JUMP_NOT_LESS, counter, bound);
+    compound_gen(keyword);
+    emit(Opcode::INCREMENT16, counter);
+    emit(Opcode::JUMP, condition);
+    program->code[exit].c = static_cast<int>(program->code.size());
+}
+
+int k_13::BytecodeCompiler::expression(const std::vector<Lexem> &expressions) {
+    ExpressionTree parser;
+    int mark = nextTemporary;
+    int value = expression(parser.parse(expressions));
+    nextTemporary = mark;
+    return value;
+}
+
+// a variable is read from its own register, everything else ends up in the
+// lowest temporary free when the node started
+int k_13::BytecodeCompiler::expression(const ExpressionNode &node) {
+    if (ExpressionTree::isLeaf(node)) {
+        switch (node.lexem.type) {
+        case LexemType::IDENTIFIER:
+            // its register is in the string file, the int one would be read
+            if (isString(node) && error.empty())
+                error = "line " + std::to_string(node.lexem.line) + ": string " + node.lexem.value
+                        + " can't be used as a number";
+            return program->registers.at(node.lexem.value);
+        case LexemType::NUMBER: {
+            int target = temporary();
+            emit(Opcode::LOAD_INT, target, node.lexem.constant);
+            return target;
+        }
+        case LexemType::TRUE:
+        case LexemType::FALSE: {
+            int target = temporary();
+            emit(Opcode::LOAD_INT, target, node.lexem.type == LexemType::TRUE ? 1 : 0);
+            return target;
+        }
+        case LexemType::STRING_LITERAL: {
+            int target = temporary();
+            emit(Opcode::LOAD_LITERAL, target, literalIndex.at(std::stoi(node.lexem.value)));
+            return target;
+        }
+        default:
+            return temporary();
+        }
+    }
+    int target = temporary();
+    if (node.operands.size() == 1) {
+        emit(Opcode::NOT, target, expression(node.operands.front()));
+        nextTemporary = target + 1;
+        return target;
+    }
+    // && and || skip the right operand like C++
+    if (node.lexem.type == LexemType::AND || node.lexem.type == LexemType::OR) {
+        emit(Opcode::TO_BOOL, target, expression(node.operands.front()));
+        nextTemporary = target + 1;
+        int skip = emit(node.lexem.type == LexemType::AND ? Opcode::JUMP_ZERO : Opcode::JUMP_NOT_ZERO, target);
+        emit(Opcode::TO_BOOL, target, expression(node.operands.back()));
+        nextTemporary = target + 1;
+        program->code[skip].b = static_cast<int>(program->code.size());
+        return target;
+    }
+    bool compare = node.lexem.type == LexemType::EQUAL || node.lexem.type == LexemType::NEQUAL
+                   || node.lexem.type == LexemType::LESS || node.lexem.type == LexemType::GREATER;
+    // comparisons with a string variable compare the contents, as std::string does
+    if (compare && (isString(node.operands.front()) || isString(node.operands.back()))) {
+        int operands[2];
+        for (int i = 0; i < 2; i++) {
+            const ExpressionNode &operand = node.operands[i];
+            if (operand.lexem.type == LexemType::STRING_LITERAL)
+                operands[i] = stringOperand(true, literalIndex.at(std::stoi(operand.lexem.value)));
+            else
+                operands[i] = stringOperand(false, program->registers.at(operand.lexem.value));
+        }
+        switch (node.lexem.type) {
+        case LexemType::EQUAL: emit(Opcode::STR_EQUAL, target, operands[0], operands[1]); break;
+        case LexemType::NEQUAL: emit(Opcode::STR_NEQUAL, target, operands[0], operands[1]); break;
+        case LexemType::LESS: emit(Opcode::STR_LESS, target, operands[0], operands[1]); break;
+        default: emit(Opcode::STR_GREATER, target, operands[0], operands[1]); break;
+        }
+        return target;
+    }
+    Opcode op;
+    switch (node.lexem.type) {
+    case LexemType::ADD: op = Opcode::ADD; break;
+    case LexemType::SUB: op = Opcode::SUB; break;
+    case LexemType::MUL: op = Opcode::MUL; break;
+    case LexemType::DIV: op = Opcode::DIV; break;
+    case LexemType::MOD: op = Opcode::MOD; break;
+    case LexemType::EQUAL: op = Opcode::EQUAL; break;
+    case LexemType::NEQUAL: op = Opcode::NEQUAL; break;
+    case LexemType::LESS: op = Opcode::LESS; break;
+    default: op = Opcode::GREATER; break;
+    }
+    int left = expression(node.operands.front());
+    int right = expression(node.operands.back());
+    line = node.lexem.line;
+    emit(op, target, left, right);
+    nextTemporary = target + 1;
+    return target;
+}
+
+bool k_13::BytecodeCompiler::isString(const ExpressionNode &node) {
+    return ExpressionTree::isLeaf(node) && node.lexem.type == LexemType::IDENTIFIER
+           && program->types.contains(node.lexem.value) && program->types.at(node.lexem.value) == LexemType::STRING;
+}
+
+// "+" with a string variable among its operands, a std::string operator+ in C++
+bool k_13::BytecodeCompiler::isConcatenation(const ExpressionNode &node) {
+    if (node.lexem.type != LexemType::ADD || node.operands.size() != 2)
+        return false;
+    std::vector<std::string> identifiers;
+    ExpressionTree::collectIdentifiers(node, identifiers);
+    for (auto &identifier : identifiers) {
+        if (program->types.contains(identifier) && program->types.at(identifier) == LexemType::STRING)
+            return true;
+    }
+    return false;
+}
+
+int k_13::BytecodeCompiler::temporary() {
+    int target = nextTemporary++;
+    if (nextTemporary > program->intRegisters)
+        program->intRegisters = nextTemporary;
+    return target;
+}
+
+int k_13::BytecodeCompiler::emit(Opcode op, int a, int b, int c) {
+    program->code.push_back({op, a, b, c});
+    program->lines.push_back(line);
+    return static_cast<int>(program->code.size()) - 1;
+}
+
+void k_13::BytecodeCompiler::safePoint(const std::string &label, int statements) {
+    if (!safePoints)
+        return;
+    emit(Opcode::SAFE_POINT, static_cast<int>(program->safePoints.size()), statements);
+    program->safePoints.push_back(label);
+}
+
+// statements one iteration runs, nested loops count at their own head
+int k_13::BytecodeCompiler::countStatements(const std::vector<Keyword> &keywords) {
+    int statements = 0;
+    for (auto &keyword : keywords) {
+        statements++;
+        if (keyword.keyword == LexemType::START)
+            statements += countStatements(keyword.keywords);
+        else if (keyword.keyword == LexemType::IF && !keyword.comp.empty())
+            statements += countStatements(keyword.comp.front().keywords);
+    }
+    return statements;
+}
+
+void k_13::BytecodeCompiler::jump(Opcode op, int a, int b, const std::string &label) {
+    int index = emit(op, a, b);
+    pendingJumps.emplace_back(index, label);
+}
+
+void k_13::BytecodeCompiler::place(const std::string &label) {
+    labels[label] = static_cast<int>(program->code.size());
+}
+
+// splits a string expression at the "+" that concatenate
+std::vector<std::vector<k_13::Lexem>> k_13::BytecodeCompiler::str_factors(const std::vector<Lexem> &expressions) {
+    std::vector<std::vector<Lexem>> factors(1);
+    int depth = 0;
+    for (auto &exp : expressions) {
+        if (exp.type == LexemType::LPAREN)
+            depth++;
+        else if (exp.type == LexemType::RPAREN)
+            depth--;
+        if (exp.type == LexemType::ADD && depth == 0)
+            factors.emplace_back();
+        else
+            factors.back().push_back(exp);
+    }
+    return factors;
+}
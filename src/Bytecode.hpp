@@ -0,0 +1,139 @@
+#pragma once
+
+#include <vector>
+#include <map>
+#include <string>
+#include <cstdint>
+
+#include "constants.hpp"
+#include "ExpressionTree.hpp"
+#include "Generator.hpp"
+
+namespace k_13 {
+    // a is the destination, b and c the operands. Jumps keep the target
+    // instruction in their last operand.
+    enum class Opcode : std::uint8_t {
+        HALT,
+        LOAD_INT,       // r[a] = b
+        LOAD_LITERAL,   // r[a] = address of literal b
+        MOVE,           // r[a] = r[b]
+        ADD,            // r[a] = r[b] + r[c], int arithmetic
+        SUB,
+        MUL,
+        DIV,
+        MOD,
+        EQUAL,          // r[a] = r[b] == r[c]
+        NEQUAL,
+        LESS,
+        GREATER,
+        STR_EQUAL,      // r[a] = string b == string c, see stringOperand
+        STR_NEQUAL,
+        STR_LESS,
+        STR_GREATER,
+        NOT,            // r[a] = !r[b]
+        TO_BOOL,        // r[a] = r[b] != 0
+        TO_INT16,       // r[a] = (int16_t)r[b]
+        JUMP,           // goto a
+        JUMP_ZERO,      // if (!r[a]) goto b
+        JUMP_NOT_ZERO,  // if (r[a]) goto b
+        JUMP_NOT_LESS,  // if (r[a] >= r[b]) goto c
+        INCREMENT16,    // r[a] = (int16_t)(r[a] + 1)
+        STR_CLEAR,      // s[a].clear()
+        STR_APPEND,     // s[a] += s[b]
+        STR_APPEND_LITERAL,
+        STR_APPEND_INT,
+        STR_APPEND_BOOL,
+        STR_APPEND_CSTR,
+        STR_SWAP,       // swap(s[a], s[b])
+        PUT,            // print s[a] and a new line
+        GET_INT16,
+        GET_BOOL,
+        GET_STRING,
+        SAFE_POINT,     // safe point a, b statements counted since the last one
+        COUNT
+    };
+
+    struct Instruction {
+        Opcode op = Opcode::HALT;
+        int a = 0;
+        int b = 0;
+        int c = 0;
+    };
+
+    struct BytecodeProgram {
+        std::vector<Instruction> code{};
+        // source line of every instruction, for runtime errors
+        std::vector<int> lines{};
+        // decoded literals, operand b of LOAD_LITERAL and STR_APPEND_LITERAL
+        std::vector<std::string> literals{};
+        // register of every variable, in the int or the string file by type
+        std::map<std::string, int> registers{};
+        std::map<std::string, LexemType> types{};
+        int intRegisters = 0;
+        int stringRegisters = 0;
+        bool interactive = false;
+        // label a resumable native build continues at, for each safe point
+        std::vector<std::string> safePoints{};
+    };
+
+// Compiles the checked Keyword tree to register bytecode. Variables own a
+// register for the whole program, temporaries are taken above them.
+class BytecodeCompiler {
+public:
+    BytecodeCompiler() = default;
+    ~BytecodeCompiler() = default;
+
+    int compile(const std::vector<Keyword> &keywords, const std::vector<Literal> &literals_, BytecodeProgram &program_);
+    void setOptions(const GeneratorOptions &options_) { options = options_; }
+    // mark for loop heads and labels, where a run can move to native code
+    void setSafePoints(bool safePoints_) { safePoints = safePoints_; }
+    // why the last compile failed
+    const std::string &getError() const { return error; }
+
+    // string registers every program has
+    static constexpr int scratchRegister = 0;
+    static constexpr int lineRegister = 1;
+    // operand of a string comparison, a string register or a literal
+    static int stringOperand(bool literal, int index) { return literal ? -index - 1 : index; }
+
+private:
+    void collectVariables(const std::vector<Keyword> &keywords);
+    void statement_ch(const std::vector<Keyword> &keywords);
+    void compound_gen(const Keyword &keyword);
+    void assign_gen(const Keyword &keyword);
+    void str_assign_gen(const Keyword &keyword);
+    void append_gen(int target, const std::vector<Lexem> &factor);
+    void append_gen(int target, const ExpressionNode &node);
+    void get_gen(const Keyword &keyword);
+    void put_gen(const Keyword &keyword);
+    void if_gen(const Keyword &keyword);
+    void for_gen(const Keyword &keyword);
+
+    int expression(const std::vector<Lexem> &expressions);
+    int expression(const ExpressionNode &node);
+    bool isString(const ExpressionNode &node);
+    bool isConcatenation(const ExpressionNode &node);
+    int temporary();
+    int emit(Opcode op, int a = 0, int b = 0, int c = 0);
+    void safePoint(const std::string &label, int statements);
+    int countStatements(const std::vector<Keyword> &keywords);
+    void jump(Opcode op, int a, int b, const std::string &label);
+    void place(const std::string &label);
+    std::vector<std::vector<Lexem>> str_factors(const std::vector<Lexem> &expressions);
+
+    GeneratorOptions options;
+    bool safePoints = false;
+    std::string error;
+    BytecodeProgram *program = nullptr;
+    std::map<int, int> literalIndex;
+    // first free temporary, registers below it hold variables or live values
+    int nextTemporary = 0;
+    int line = 0;
+    std::map<std::string, int> labels;
+    // jumps to labels placed later, patched at the end
+    std::vector<std::pair<int, std::string>> pendingJumps;
+    // loops compiled so far, numbered like Generator numbers them
+    int loops = 0;
+};
+
+} // k_13
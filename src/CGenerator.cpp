@@ -0,0 +1,370 @@
+#include "CGenerator.hpp"
+
+int k_13::CGenerator::createC(const std::vector<Keyword> &keywords, const std::string &progName, const std::string &outPath, const std::vector<Literal> &literals_) {
+    std::filesystem::path outputFile = outPath;
+    outputFile /= (progName + ".c");
+    std::ofstream file(outputFile);
+
+    if(!file.is_open()) {
+        return -1;
+    }
+    literals = literals_;
+    generate(keywords, file);
+    file.close();
+    return 0;
+}
+
+// all variables live at the top of k13_main, so goto never skips a
+// declaration and strings are allocated once. A block empties its strings
+// when it is entered, like a fresh declaration.
+void k_13::CGenerator::generate(const std::vector<Keyword> &keywords, std::ostream &file) {
+    variables.clear();
+    collectVariables(keywords);
+    file << "#include \"k13rt.h\"\n\n";
+    for (auto &literal : literals)
+        file << "static const char k13_lit" << literal.id << "[] = " << literal.value << ";\n";
+    file << "static k13_string k13_scratch;\n"
+            "static k13_string k13_line;\n\n"
+            "void k13_main(void) {\n";
+    for (auto &variable : variables) {
+        switch (variable.second) {
+        case LexemType::BOOL:
+            file << "bool " << variable.first << " = false;\n";
+            break;
+        case LexemType::INT:
+            file << "int16_t " << variable.first << " = 0;\n";
+            break;
+        case LexemType::NUMBER:
+            file << "int " << variable.first << " = 0;\n";
+            break;
+        case LexemType::STRING:
+            file << "k13_string " << variable.first << " = {0};\n";
+            break;
+        default:
+            break;
+        }
+    }
+    statement_ch(keywords, file);
+    file << "}\n";
+}
+
+void k_13::CGenerator::collectVariables(const std::vector<Keyword> &keywords) {
+    for (auto &keyword : keywords) {
+        switch (keyword.keyword) {
+        case LexemType::START:
+            variables.insert(keyword.variables.begin(), keyword.variables.end());
+            collectVariables(keyword.keywords);
+            break;
+        case LexemType::FOR:
+            variables.insert(keyword.variables.begin(), keyword.variables.end());
+            // the counter of a loop may be used without a declaration
+            variables.insert({keyword.label, LexemType::INT});
+            collectVariables(keyword.keywords);
+            break;
+        case LexemType::IF:
+            if (!keyword.comp.empty()) {
+                variables.insert(keyword.comp.front().variables.begin(), keyword.comp.front().variables.end());
+                collectVariables(keyword.comp.front().keywords);
+            }
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void k_13::CGenerator::statement_ch(const std::vector<Keyword> &keywords, std::ostream &file) {
+    for (auto &keyword : keywords) {
+        switch (keyword.keyword) {
+        case LexemType::START:
+            compound_gen(keyword, file);
+            break;
+        case LexemType::ASSIGN:
+            assign_gen(keyword, file);
+            break;
+        case LexemType::GET:
+            get_gen(keyword, file);
+            break;
+        case LexemType::PUT:
+            put_gen(keyword, file);
+            break;
+        case LexemType::GOTO:
+            file << "goto " << keyword.label << ";\n";
+            break;
+        case LexemType::LABEL:
+            file << keyword.label << ":;\n";
+            break;
+        case LexemType::IF:
+            if_gen(keyword, file);
+            break;
+        case LexemType::FOR:
+            for_gen(keyword, file);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void k_13::CGenerator::compound_gen(const Keyword &keyword, std::ostream &file) {
+    file << "{\n";
+    for (auto &var : keyword.variables) {
+        if (var.second == LexemType::STRING)
+            file << "k13_str_clear(&" << var.first << ");\n";
+    }
+    statement_ch(keyword.keywords, file);
+    file << "}\n";
+}
+
+void k_13::CGenerator::assign_gen(const Keyword &keyword, std::ostream &file) {
+    if (variables.at(keyword.label) == LexemType::STRING) {
+        str_assign_gen(keyword, file);
+        return;
+    }
+    file << keyword.label << " = ";
+    expression(keyword.expression1, file);
+    file << ";\n";
+}
+
+// x := x + ... appends in place. When the target is read anywhere else the
+// value is built in k13_scratch and swapped in.
+void k_13::CGenerator::str_assign_gen(const Keyword &keyword, std::ostream &file) {
+    std::vector<std::vector<Lexem>> factors = str_factors(keyword.expression1);
+    std::size_t first = 0;
+    if (factors.size() > 1 && factors.front().size() == 1 && factors.front().front().type == LexemType::IDENTIFIER
+        && factors.front().front().value == keyword.label)
+        first = 1;
+    bool readsTarget = false;
+    for (std::size_t i = first; i < factors.size(); i++) {
+        for (auto &exp : factors[i]) {
+            if (exp.type == LexemType::IDENTIFIER && exp.value == keyword.label)
+                readsTarget = true;
+        }
+    }
+    if (readsTarget)
+        first = 0;
+    std::string target = readsTarget ? "k13_scratch" : keyword.label;
+    if (first == 0)
+        file << "k13_str_clear(&" << target << ");\n";
+    for (std::size_t i = first; i < factors.size(); i++)
+        append_gen(target, factors[i], file);
+    if (readsTarget)
+        file << "k13_str_swap(&" << keyword.label << ", &k13_scratch);\n";
+}
+
+void k_13::CGenerator::append_gen(const std::string &target, const std::vector<Lexem> &factor, std::ostream &file) {
+    ExpressionTree parser;
+    append_gen(target, parser.parse(factor), file);
+}
+
+// the value is printed as the C++ backend's k13_append overload would. A
+// concatenation in parentheses appends its operands one after the other.
+void k_13::CGenerator::append_gen(const std::string &target, const ExpressionNode &node, std::ostream &file) {
+    if (isConcatenation(node)) {
+        for (auto &operand : node.operands)
+            append_gen(target, operand, file);
+        return;
+    }
+    if (!ExpressionTree::isLeaf(node)) {
+        if (ExpressionTree::isLogical(node))
+            file << "k13_str_append_bool(&" << target << ", ";
+        else if (ExpressionTree::hasStringLiteral(node))
+            file << "k13_str_append_cstr(&" << target << ", ";
+        else
+            file << "k13_str_append_int(&" << target << ", ";
+        expression(node, file);
+        file << ");\n";
+        return;
+    }
+    switch (node.lexem.type) {
+    case LexemType::STRING_LITERAL:
+        file << "k13_str_append(&" << target << ", k13_lit" << node.lexem.value << ", sizeof(k13_lit" << node.lexem.value << ") - 1);\n";
+        break;
+    case LexemType::NUMBER: {
+        std::string digits = std::to_string(node.lexem.constant);
+        file << "k13_str_append(&" << target << ", \"" << digits << "\", " << digits.size() << ");\n";
+        break;
+    }
+    case LexemType::TRUE:
+        file << "k13_str_append(&" << target << ", \"1\", 1);\n";
+        break;
+    case LexemType::FALSE:
+        file << "k13_str_append(&" << target << ", \"0\", 1);\n";
+        break;
+    case LexemType::IDENTIFIER:
+        switch (variables.at(node.lexem.value)) {
+        case LexemType::STRING:
+            file << "k13_str_append(&" << target << ", " << node.lexem.value << ".data, " << node.lexem.value << ".size);\n";
+            break;
+        case LexemType::BOOL:
+            file << "k13_str_append_bool(&" << target << ", " << node.lexem.value << ");\n";
+            break;
+        default:
+            file << "k13_str_append_int(&" << target << ", " << node.lexem.value << ");\n";
+            break;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void k_13::CGenerator::get_gen(const Keyword &keyword, std::ostream &file) {
+    switch (variables.at(keyword.label)) {
+    case LexemType::INT:
+        file << keyword.label << " = k13_get_int16(" << keyword.label << ");\n";
+        break;
+    case LexemType::BOOL:
+        file << keyword.label << " = k13_get_bool(" << keyword.label << ");\n";
+        break;
+    case LexemType::STRING:
+        file << "k13_get_string(&" << keyword.label << ");\n";
+        break;
+    default:
+        break;
+    }
+}
+
+void k_13::CGenerator::put_gen(const Keyword &keyword, std::ostream &file) {
+    file << "k13_str_clear(&k13_line);\n";
+    for (auto &factor : str_factors(keyword.expression1))
+        append_gen("k13_line", factor, file);
+    file << "k13_put_line(&k13_line);\n";
+    if (options.interactive)
+        file << "k13_flush();\n";
+}
+
+void k_13::CGenerator::if_gen(const Keyword &keyword, std::ostream &file) {
+    file << "if (";
+    expression(keyword.expression1, file);
+    file << ") goto " << keyword.label << ";\n";
+    if (!keyword.comp.empty())
+        compound_gen(keyword.comp.front(), file);
+    if (!keyword.label2.empty())
+        file << "goto " << keyword.label2 << ";\n";
+    if (!keyword.label3.empty())
+        file << keyword.label3 << ":;\n";
+}
+
+void k_13::CGenerator::for_gen(const Keyword &keyword, std::ostream &file) {
+    file << "for (" << keyword.label << "=";
+    expression(keyword.expression1, file);
+    file << "; " << keyword.label << "<";
+    expression(keyword.expression2, file);
+    file << "; " << keyword.label << "++) ";
+    compound_gen(keyword, file);
+}
+
+void k_13::CGenerator::expression(const std::vector<Lexem> &expressions, std::ostream &file) {
+    ExpressionTree parser;
+    expression(parser.parse(expressions), file);
+}
+
+// same shape as the source. Comparisons with a string variable compare the
+// contents, as std::string does, other literals stay pointers.
+void k_13::CGenerator::expression(const ExpressionNode &node, std::ostream &file) {
+    for (int i = 0; i < node.parentheses; i++)
+        file << "(";
+    if (node.operands.size() == 1) {
+        file << "!";
+        expression(node.operands.front(), file);
+    }
+    else if (node.operands.size() == 2) {
+        const ExpressionNode &left = node.operands.front();
+        const ExpressionNode &right = node.operands.back();
+        bool compare = node.lexem.type == LexemType::EQUAL || node.lexem.type == LexemType::NEQUAL
+                       || node.lexem.type == LexemType::LESS || node.lexem.type == LexemType::GREATER;
+        if (compare && (isString(left) || isString(right))) {
+            file << "k13_str_compare(";
+            str_operand(left, file);
+            file << ", ";
+            str_operand(right, file);
+            file << ") ";
+        }
+        else
+            expression(left, file);
+        switch (node.lexem.type) {
+        case LexemType::ADD: file << "+"; break;
+        case LexemType::SUB: file << "-"; break;
+        case LexemType::MUL: file << "*"; break;
+        case LexemType::DIV: file << "/"; break;
+        case LexemType::MOD: file << "%"; break;
+        case LexemType::AND: file << "&&"; break;
+        case LexemType::OR: file << "||"; break;
+        case LexemType::EQUAL: file << "=="; break;
+        case LexemType::NEQUAL: file << "!="; break;
+        case LexemType::LESS: file << "<"; break;
+        case LexemType::GREATER: file << ">"; break;
+        default: break;
+        }
+        if (compare && (isString(left) || isString(right)))
+            file << " 0";
+        else
+            expression(right, file);
+    }
+    else {
+        switch (node.lexem.type) {
+        case LexemType::NUMBER:
+            file << node.lexem.constant;
+            break;
+        case LexemType::IDENTIFIER:
+            file << node.lexem.value;
+            break;
+        case LexemType::STRING_LITERAL:
+            file << "k13_lit" << node.lexem.value;
+            break;
+        case LexemType::TRUE:
+            file << "true";
+            break;
+        case LexemType::FALSE:
+            file << "false";
+            break;
+        default:
+            break;
+        }
+    }
+    for (int i = 0; i < node.parentheses; i++)
+        file << ")";
+}
+
+void k_13::CGenerator::str_operand(const ExpressionNode &node, std::ostream &file) {
+    if (node.lexem.type == LexemType::STRING_LITERAL)
+        file << "k13_lit" << node.lexem.value << ", sizeof(k13_lit" << node.lexem.value << ") - 1";
+    else
+        file << node.lexem.value << ".data, " << node.lexem.value << ".size";
+}
+
+bool k_13::CGenerator::isString(const ExpressionNode &node) {
+    return ExpressionTree::isLeaf(node) && node.lexem.type == LexemType::IDENTIFIER
+           && variables.contains(node.lexem.value) && variables.at(node.lexem.value) == LexemType::STRING;
+}
+
+// "+" with a string variable among its operands, a std::string operator+ in C++
+bool k_13::CGenerator::isConcatenation(const ExpressionNode &node) {
+    if (node.lexem.type != LexemType::ADD || node.operands.size() != 2)
+        return false;
+    std::vector<std::string> identifiers;
+    ExpressionTree::collectIdentifiers(node, identifiers);
+    for (auto &identifier : identifiers) {
+        if (variables.contains(identifier) && variables.at(identifier) == LexemType::STRING)
+            return true;
+    }
+    return false;
+}
+
+// splits a string expression at the "+" that concatenate
+std::vector<std::vector<k_13::Lexem>> k_13::CGenerator::str_factors(const std::vector<Lexem> &expressions) {
+    std::vector<std::vector<Lexem>> factors(1);
+    int depth = 0;
+    for (auto &exp : expressions) {
+        if (exp.type == LexemType::LPAREN)
+            depth++;
+        else if (exp.type == LexemType::RPAREN)
+            depth--;
+        if (exp.type == LexemType::ADD && depth == 0)
+            factors.emplace_back();
+        else
+            factors.back().push_back(exp);
+    }
+    return factors;
+}
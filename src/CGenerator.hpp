@@ -0,0 +1,51 @@
+#pragma once
+
+#include <filesystem>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <map>
+
+#include "constants.hpp"
+#include "ExpressionTree.hpp"
+#include "Generator.hpp"
+
+namespace k_13 {
+// C99 backend. The program becomes k13_main() on top of the runtime in
+// runtime/k13rt.h, which provides strings, buffered I/O and the entry point.
+class CGenerator {
+public:
+    CGenerator() = default;
+    ~CGenerator() = default;
+
+    int createC(const std::vector<Keyword> &keywords, const std::string &progName, const std::string &outPath, const std::vector<Literal> &literals_);
+    void setOptions(const GeneratorOptions &options_) { options = options_; }
+
+private:
+    void generate(const std::vector<Keyword> &keywords, std::ostream &file);
+    void collectVariables(const std::vector<Keyword> &keywords);
+    void statement_ch(const std::vector<Keyword> &keywords, std::ostream &file);
+    void compound_gen(const Keyword &keyword, std::ostream &file);
+    void assign_gen(const Keyword &keyword, std::ostream &file);
+    void str_assign_gen(const Keyword &keyword, std::ostream &file);
+    void append_gen(const std::string &target, const std::vector<Lexem> &factor, std::ostream &file);
+    void append_gen(const std::string &target, const ExpressionNode &node, std::ostream &file);
+    void get_gen(const Keyword &keyword, std::ostream &file);
+    void put_gen(const Keyword &keyword, std::ostream &file);
+    void if_gen(const Keyword &keyword, std::ostream &file);
+    void for_gen(const Keyword &keyword, std::ostream &file);
+
+    void expression(const std::vector<Lexem> &expressions, std::ostream &file);
+    void expression(const ExpressionNode &node, std::ostream &file);
+    void str_operand(const ExpressionNode &node, std::ostream &file);
+    bool isString(const ExpressionNode &node);
+    bool isConcatenation(const ExpressionNode &node);
+    std::vector<std::vector<Lexem>> str_factors(const std::vector<Lexem> &expressions);
+
+    std::vector<Literal> literals;
+    GeneratorOptions options;
+    // every variable of the program, names are unique across blocks
+    std::map<std::string, LexemType> variables;
+};
+
+} // k_13
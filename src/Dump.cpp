@@ -0,0 +1,371 @@
+#include "Dump.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <sstream>
+
+namespace {
+    // rows are handed to dump.jsonl in blocks of this size
+    const std::size_t dumpBlock = 1 << 16;
+
+    // bytes of the well-formed UTF-8 sequence at value[i], 0 when it isn't one
+    std::size_t utf8Length(std::string_view value, std::size_t i) {
+        auto byte = [&](std::size_t at) { return static_cast<unsigned char>(value[at]); };
+        unsigned char lead = byte(i);
+        std::size_t length;
+        // the range of the second byte rules out overlong forms, surrogates and code points past U+10FFFF
+        unsigned char low = 0x80;
+        unsigned char high = 0xbf;
+        if (lead >= 0xc2 && lead <= 0xdf)
+            length = 2;
+        else if (lead >= 0xe0 && lead <= 0xef) {
+            length = 3;
+            if (lead == 0xe0)
+                low = 0xa0;
+            else if (lead == 0xed)
+                high = 0x9f;
+        }
+        else if (lead >= 0xf0 && lead <= 0xf4) {
+            length = 4;
+            if (lead == 0xf0)
+                low = 0x90;
+            else if (lead == 0xf4)
+                high = 0x8f;
+        }
+        else
+            return 0;
+        if (i + length > value.size() || byte(i + 1) < low || byte(i + 1) > high)
+            return 0;
+        for (std::size_t k = 2; k < length; k++) {
+            if (byte(i + k) < 0x80 || byte(i + k) > 0xbf)
+                return 0;
+        }
+        return length;
+    }
+}
+
+bool k_13::Dump::select(const std::string &list, DumpOptions &options) {
+    std::stringstream names(list);
+    std::string name;
+    while (std::getline(names, name, ',')) {
+        if (name == "tokens")
+            options.tokens = true;
+        else if (name == "literals")
+            options.literals = true;
+        else if (name == "unknown")
+            options.unknown = true;
+        else if (name == "identifiers")
+            options.identifiers = true;
+        else if (name == "labels")
+            options.labels = true;
+        else if (name == "variables")
+            options.variables = true;
+        else if (name == "expressions")
+            options.expressions = true;
+        else if (name == "symbols")
+            options.identifiers = options.labels = options.variables = true;
+        else if (name == "all")
+            options.tokens = options.literals = options.unknown = options.identifiers = options.labels
+                = options.variables = options.expressions = true;
+        else
+            return false;
+    }
+    return true;
+}
+
+int k_13::Dump::open(const DumpOptions &options_, const std::string &outDir) {
+    options = options_;
+    if (!options.any())
+        return 0;
+    path = std::filesystem::path(outDir) / (options.text ? "allLexems.txt" : "dump.jsonl");
+    file = Emitter();
+    if (!options.text) {
+        output.open(path, std::ios::binary);
+        if (!output.is_open())
+            return -1;
+        file = Emitter(&output, dumpBlock);
+    }
+    opened = true;
+    return 0;
+}
+
+void k_13::Dump::lexical(const FrontEnd &frontEnd) {
+    if (!opened)
+        return;
+    auto begin = std::chrono::steady_clock::now();
+    if (options.text) {
+        if (options.tokens)
+            lexems_text(frontEnd.lexems);
+        if (options.literals)
+            literals_text(frontEnd.literals);
+        if (options.unknown)
+            unknown_text(frontEnd.unknownLexems);
+    }
+    else {
+        if (options.tokens)
+            tokens_json(frontEnd.lexems);
+        if (options.literals)
+            literals_json(frontEnd.literals);
+        if (options.unknown)
+            unknown_json(frontEnd.unknownLexems);
+        file.flush();
+    }
+    elapsed += std::chrono::steady_clock::now() - begin;
+}
+
+void k_13::Dump::syntax(const FrontEnd &frontEnd) {
+    if (!opened)
+        return;
+    auto begin = std::chrono::steady_clock::now();
+    if (options.text) {
+        if (options.identifiers)
+            identifiers_text(frontEnd.identifiers);
+        if (options.labels)
+            labels_text(frontEnd.labels);
+        if (options.variables)
+            variables_text(frontEnd.variableTable);
+        if (options.expressions)
+            expressions_text(frontEnd.expressions);
+    }
+    else {
+        if (options.identifiers) {
+            for (auto &identifier : frontEnd.identifiers) {
+                for (auto &use : identifier.second)
+                    usage_json("identifiers", identifier.first, use);
+            }
+        }
+        if (options.labels) {
+            for (auto &label : frontEnd.labels) {
+                for (auto &use : label.second)
+                    usage_json("labels", label.first, use);
+            }
+        }
+        if (options.variables)
+            variables_json(frontEnd.variableTable);
+        if (options.expressions)
+            expressions_json(frontEnd.expressions);
+        file.flush();
+    }
+    elapsed += std::chrono::steady_clock::now() - begin;
+}
+
+int k_13::Dump::close() {
+    if (!opened)
+        return 0;
+    opened = false;
+    auto begin = std::chrono::steady_clock::now();
+    int status = 0;
+    if (options.text)
+        status = file.writeFile(path);
+    else {
+        if (!file.flush())
+            status = -1;
+        output.close();
+        if (!output)
+            status = -1;
+    }
+    elapsed += std::chrono::steady_clock::now() - begin;
+    return status;
+}
+
+void k_13::Dump::tokens_json(const std::vector<Lexem> &lexems) {
+    for (auto &lexem : lexems) {
+        file << "{\"table\":\"tokens\",\"line\":" << lexem.line << ",\"lexem\":";
+        string_json(lexem.value);
+        file << ",\"constant\":" << lexem.constant << ",\"code\":" << static_cast<std::underlying_type_t<LexemType>>(lexem.type)
+             << ",\"type\":\"" << constants.enumToStringLexems[lexem.type] << "\"}\n";
+    }
+}
+
+void k_13::Dump::literals_json(const std::vector<Literal> &literals) {
+    for (auto &literal : literals) {
+        file << "{\"table\":\"literals\",\"id\":" << literal.id << ",\"value\":";
+        string_json(literal.value);
+        file << "}\n";
+    }
+}
+
+void k_13::Dump::unknown_json(const std::vector<UnknownLexem> &unknownLexems) {
+    for (auto &unknownLexem : unknownLexems) {
+        file << "{\"table\":\"unknown\",\"id\":" << unknownLexem.id << ",\"value\":";
+        string_json(unknownLexem.value);
+        file << "}\n";
+    }
+}
+
+void k_13::Dump::usage_json(const char *table, const std::string &name, const std::pair<int, ExpressionType> &use) {
+    file << "{\"table\":\"" << table << "\",\"name\":";
+    string_json(name);
+    file << ",\"line\":" << use.first << ",\"code\":" << static_cast<std::underlying_type_t<ExpressionType>>(use.second)
+         << ",\"expression\":\"" << constants.enumToStringExpressions[use.second] << "\"}\n";
+}
+
+void k_13::Dump::variables_json(const std::map<std::string, LexemType> &variableTable) {
+    for (auto &variable : variableTable) {
+        file << "{\"table\":\"variables\",\"name\":";
+        string_json(variable.first);
+        file << ",\"code\":" << static_cast<std::underlying_type_t<LexemType>>(variable.second)
+             << ",\"type\":\"" << constants.enumToStringLexems[variable.second] << "\"}\n";
+    }
+}
+
+void k_13::Dump::expressions_json(const std::list<std::pair<LexemType, std::vector<Lexem>>> &expressions) {
+    for (auto &expression : expressions) {
+        file << "{\"table\":\"expressions\",\"code\":" << static_cast<std::underlying_type_t<LexemType>>(expression.first)
+             << ",\"type\":\"" << constants.enumToStringLexems[expression.first] << "\",\"lexems\":[";
+        for (std::size_t i = 0; i < expression.second.size(); i++) {
+            if (i)
+                file << ',';
+            string_json(expression.second[i].value);
+        }
+        file << "]}\n";
+    }
+}
+
+// a JSON string. UTF-8 is passed through as it is, a byte that isn't part of
+// well-formed UTF-8 is written as \u00XX so the line still parses
+void k_13::Dump::string_json(std::string_view value) {
+    static const char hex[] = "0123456789abcdef";
+    file << '"';
+    std::size_t plain = 0;
+    for (std::size_t i = 0; i < value.size(); i++) {
+        auto ch = static_cast<unsigned char>(value[i]);
+        if (ch >= 0x80) {
+            if (std::size_t length = utf8Length(value, i)) {
+                i += length - 1;
+                continue;
+            }
+        }
+        else if (ch >= 0x20 && ch != '"' && ch != '\\')
+            continue;
+        file << value.substr(plain, i - plain);
+        plain = i + 1;
+        switch (ch) {
+        case '"': file << "\\\""; break;
+        case '\\': file << "\\\\"; break;
+        case '\n': file << "\\n"; break;
+        case '\r': file << "\\r"; break;
+        case '\t': file << "\\t"; break;
+        default:
+            file << "\\u00" << hex[ch >> 4] << hex[ch & 0xf];
+            break;
+        }
+    }
+    file << value.substr(plain) << '"';
+}
+
+void k_13::Dump::lexems_text(const std::vector<Lexem> &lexems) {
+    file << "|----------------------------------------------------------------------------------------|\n";
+    file << "|                                     Lexems table                                       |\n";
+    file << "|----------------------------------------------------------------------------------------|\n";
+    file << "|   line number  |     lexem     |     value     |  lexem code  |     type of lexem      |\n";
+    file << "|----------------------------------------------------------------------------------------|\n";
+    for (auto &lexem : lexems) {
+        auto &type = constants.enumToStringLexems[lexem.type];
+        file << "|\t" << lexem.line << findDistance(14, lexem.line) << " |\t" << lexem.value << findDistance(10, lexem.value) << " |\t" << lexem.constant << "\t |\t" << static_cast<std::underlying_type_t<LexemType>>(lexem.type) << " \t|\t";
+        file << type << findDistance(18, type) << " |\n";
+        file << "|----------------------------------------------------------------------------------------|\n";
+    }
+}
+
+void k_13::Dump::literals_text(const std::vector<Literal> &literals) {
+    file << "\n|----------------------------------------------------------------------------------------\n";
+    file << "|                          Literals table\n";
+    file << "|----------------------------------------------------------------------------------------\n";
+    file << "|   literal id   | value \n";
+    file << "|----------------------------------------------------------------------------------------\n";
+    for (auto &literal : literals) {
+        file << "|\t" << literal.id << findDistance(10, literal.id) << " |\t" << literal.value << " \n";
+        file << "|----------------------------------------------------------------------------------------\n";
+    }
+}
+
+void k_13::Dump::unknown_text(const std::vector<UnknownLexem> &unknownLexems) {
+    file << "\n|----------------------------------------------------------------------------------------\n";
+    file << "|                      Unknown lexems table\n";
+    file << "|----------------------------------------------------------------------------------------\n";
+    file << "|   unknown id   | value \n";
+    file << "|----------------------------------------------------------------------------------------\n";
+    for (auto &unknownLexem : unknownLexems) {
+        file << "|\t" << unknownLexem.id << findDistance(10, unknownLexem.id) << " |\t" << unknownLexem.value << " \n";
+        file << "|----------------------------------------------------------------------------------------\n";
+    }
+}
+
+void k_13::Dump::identifiers_text(const std::map<std::string, std::vector<std::pair<int, ExpressionType>>> &identifiers) {
+    file << "|----------------------------------------------------------------------------------------|\n";
+    file << "|                                 Identifiers usage                                      |\n";
+    file << "|----------------------------------------------------------------------------------------|\n";
+    file << "|   identifier   |   line number   |   expression type   |\n";
+    file << "|----------------------------------------------------------------------------------------|\n";
+    for (auto &identifier : identifiers) {
+        for (auto &line : identifier.second) {
+            auto &type = constants.enumToStringExpressions[line.second];
+            file << "|\t" << identifier.first << findDistance(14, identifier.first) << " |\t" << line.first << findDistance(14, line.first) << " |\t" << static_cast<std::underlying_type_t<ExpressionType>>(line.second) << " \t|\t";
+            file << type << findDistance(18, type) << " |\n";
+            file << "|----------------------------------------------------------------------------------------|\n";
+        }
+    }
+}
+
+void k_13::Dump::labels_text(const std::map<std::string, std::list<std::pair<int, ExpressionType>>> &labels) {
+    file << "|----------------------------------------------------------------------------------------|\n";
+    file << "|                                     Labels usage                                       |\n";
+    file << "|----------------------------------------------------------------------------------------|\n";
+    file << "|   label   |   line number   |   expression type   |\n";
+    file << "|----------------------------------------------------------------------------------------|\n";
+    for (auto &label : labels) {
+        for (auto &line : label.second) {
+            auto &type = constants.enumToStringExpressions[line.second];
+            file << "|\t" << label.first << findDistance(10, label.first) << " |\t" << line.first << findDistance(14, line.first) << " |\t" << static_cast<std::underlying_type_t<ExpressionType>>(line.second) << " \t|\t";
+            file << type << findDistance(18, type) << " |\n";
+            file << "|----------------------------------------------------------------------------------------|\n";
+        }
+    }
+}
+
+void k_13::Dump::variables_text(const std::map<std::string, LexemType> &variableTable) {
+    file << "|----------------------------------------------------------------------------------------|\n";
+    file << "|                                     Variables table                                     |\n";
+    file << "|----------------------------------------------------------------------------------------|\n";
+    file << "|   variable   |   type   |\n";
+    file << "|----------------------------------------------------------------------------------------|\n";
+    for (auto &variable : variableTable) {
+        auto &type = constants.enumToStringLexems[variable.second];
+        file << "|\t" << variable.first << findDistance(14, variable.first) << " |\t" << static_cast<std::underlying_type_t<LexemType>>(variable.second) << " \t|\t";
+        file << type << findDistance(18, type) << " |\n";
+        file << "|----------------------------------------------------------------------------------------|\n";
+    }
+}
+
+void k_13::Dump::expressions_text(const std::list<std::pair<LexemType, std::vector<Lexem>>> &expressions) {
+    file << "|----------------------------------------------------------------------------------------|\n";
+    file << "|                                     Expressions table                                   |\n";
+    file << "|----------------------------------------------------------------------------------------|\n";
+    file << "|   expression type   |   expression   \n";
+    file << "|----------------------------------------------------------------------------------------|\n";
+    for (auto &expression : expressions) {
+        auto code = static_cast<std::underlying_type_t<LexemType>>(expression.first);
+        file << "|\t" << code << findDistance(20, code) << " |\t";
+        for (auto &lexem : expression.second) {
+            file << lexem.value << " ";
+        }
+        file << "|\n";
+        file << "|----------------------------------------------------------------------------------------|\n";
+    }
+}
+
+std::string_view k_13::Dump::findDistance(int maxSize, std::size_t length) {
+    static const std::string_view tabs = "\t\t\t\t\t\t\t\t";
+    int distance = maxSize - static_cast<int>(length - (length % 8));
+    return tabs.substr(0, static_cast<std::size_t>(std::clamp(distance / 8, 0, static_cast<int>(tabs.size()))));
+}
+
+std::string_view k_13::Dump::findDistance(int maxSize, const std::string &value) {
+    return findDistance(maxSize, value.length());
+}
+
+std::string_view k_13::Dump::findDistance(int maxSize, int number) {
+    char digits[16];
+    return findDistance(maxSize, static_cast<std::size_t>(std::to_chars(digits, digits + sizeof(digits), number).ptr - digits));
+}
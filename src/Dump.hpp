@@ -0,0 +1,89 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "constants.hpp"
+#include "Emitter.hpp"
+#include "FrontEndCache.hpp"
+
+namespace k_13 {
+    struct DumpOptions {
+        bool tokens = false;
+        bool literals = false;
+        bool unknown = false;
+        bool identifiers = false;
+        bool labels = false;
+        bool variables = false;
+        bool expressions = false;
+        // allLexems.txt with tab padded tables instead of dump.jsonl
+        bool text = false;
+
+        bool any() const { return tokens || literals || unknown || identifiers || labels || variables || expressions; }
+    };
+
+// Tables of the front end, written only for the ones asked for. As JSON lines
+// (dump.jsonl) every row is an object with a "table" member, and the rows of a
+// phase go out in 64 KiB blocks as soon as the phase is done. The text format
+// is the tab padded allLexems.txt, written in one call when the dump closes.
+class Dump {
+public:
+    Dump() = default;
+    ~Dump() = default;
+
+    // adds the tables of a comma separated list to options: tokens, literals,
+    // unknown, identifiers, labels, variables, expressions, symbols (identifiers,
+    // labels and variables) or all. False when a name isn't one of them
+    static bool select(const std::string &list, DumpOptions &options);
+
+    // 0 when the dump file could be created, nothing is opened when no table is asked for
+    int open(const DumpOptions &options_, const std::string &outDir);
+    bool isOpen() const { return opened; }
+    // tokens, literals and unknown lexems
+    void lexical(const FrontEnd &frontEnd);
+    // identifiers, labels, variables and expressions
+    void syntax(const FrontEnd &frontEnd);
+    // 0 when everything was written
+    int close();
+
+    const std::filesystem::path &getPath() const { return path; }
+    std::size_t getBytes() const { return file.size(); }
+    // time spent formatting and writing
+    std::chrono::steady_clock::duration getElapsed() const { return elapsed; }
+
+private:
+    void tokens_json(const std::vector<Lexem> &lexems);
+    void literals_json(const std::vector<Literal> &literals);
+    void unknown_json(const std::vector<UnknownLexem> &unknownLexems);
+    void usage_json(const char *table, const std::string &name, const std::pair<int, ExpressionType> &use);
+    void variables_json(const std::map<std::string, LexemType> &variableTable);
+    void expressions_json(const std::list<std::pair<LexemType, std::vector<Lexem>>> &expressions);
+    void string_json(std::string_view value);
+
+    void lexems_text(const std::vector<Lexem> &lexems);
+    void literals_text(const std::vector<Literal> &literals);
+    void unknown_text(const std::vector<UnknownLexem> &unknownLexems);
+    void identifiers_text(const std::map<std::string, std::vector<std::pair<int, ExpressionType>>> &identifiers);
+    void labels_text(const std::map<std::string, std::list<std::pair<int, ExpressionType>>> &labels);
+    void variables_text(const std::map<std::string, LexemType> &variableTable);
+    void expressions_text(const std::list<std::pair<LexemType, std::vector<Lexem>>> &expressions);
+
+    // tabs that fill a column of maxSize characters after a value of the given length
+    static std::string_view findDistance(int maxSize, std::size_t length);
+    static std::string_view findDistance(int maxSize, const std::string &value);
+    static std::string_view findDistance(int maxSize, int number);
+
+    constants_k13 constants;
+    DumpOptions options;
+    std::filesystem::path path;
+    bool opened = false;
+    std::ofstream output;
+    Emitter file;
+    std::chrono::steady_clock::duration elapsed{};
+};
+} // k_13
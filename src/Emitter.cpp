@@ -0,0 +1,131 @@
+#include "Emitter.hpp"
+
+#include <fstream>
+
+#ifdef _WIN32
+#define K13_WRITEV 0
+#else
+#define K13_WRITEV 1
+#include <cerrno>
+#include <climits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#endif
+
+namespace {
+    // smaller texts are copied, a piece of their own isn't worth a vector entry
+    const std::size_t pieceSize = 4096;
+#if K13_WRITEV
+#ifdef IOV_MAX
+    const int maxVectors = IOV_MAX < 1024 ? IOV_MAX : 1024;
+#else
+    const int maxVectors = 16;
+#endif
+#endif
+}
+
+k_13::Emitter &k_13::Emitter::operator<<(Emitter &&other) {
+    if (other.held + other.buffer.size() < pieceSize) {
+        for (auto &piece : other.pieces)
+            buffer += piece;
+        buffer += other.buffer;
+    }
+    else {
+        if (!buffer.empty()) {
+            held += buffer.size();
+            pieces.push_back(std::move(buffer));
+            buffer.clear();
+        }
+        for (auto &piece : other.pieces) {
+            held += piece.size();
+            pieces.push_back(std::move(piece));
+        }
+        if (!other.buffer.empty()) {
+            held += other.buffer.size();
+            pieces.push_back(std::move(other.buffer));
+        }
+    }
+    other.pieces.clear();
+    other.buffer.clear();
+    other.held = 0;
+    return spill();
+}
+
+bool k_13::Emitter::flush() {
+    if (sink) {
+        for (auto &piece : pieces)
+            sink->write(piece.data(), static_cast<std::streamsize>(piece.size()));
+        sink->write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        sink->flush();
+    }
+    flushed += held + buffer.size();
+    pieces.clear();
+    held = 0;
+    buffer.clear();
+    return !sink || static_cast<bool>(*sink);
+}
+
+int k_13::Emitter::writeFile(const std::filesystem::path &path, bool append) {
+    std::vector<std::string_view> parts(pieces.begin(), pieces.end());
+    parts.push_back(buffer);
+    int status = 0;
+#if K13_WRITEV
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | (append ? O_APPEND : O_TRUNC), 0666);
+    if (fd < 0)
+        return -1;
+    // parts[first] is written up to offset
+    std::size_t first = 0;
+    std::size_t offset = 0;
+    while (status == 0) {
+        while (first < parts.size() && offset == parts[first].size()) {
+            first++;
+            offset = 0;
+        }
+        if (first == parts.size())
+            break;
+        iovec vectors[maxVectors];
+        int count = 0;
+        for (std::size_t i = first; i < parts.size() && count < maxVectors; i++) {
+            std::size_t skip = i == first ? offset : 0;
+            vectors[count].iov_base = const_cast<char *>(parts[i].data() + skip);
+            vectors[count].iov_len = parts[i].size() - skip;
+            count++;
+        }
+        ssize_t written = ::writev(fd, vectors, count);
+        if (written < 0) {
+            if (errno != EINTR)
+                status = -1;
+            continue;
+        }
+        // a short write leaves the rest for the next round
+        auto left = static_cast<std::size_t>(written);
+        while (left > 0) {
+            std::size_t rest = parts[first].size() - offset;
+            if (left < rest) {
+                offset += left;
+                break;
+            }
+            left -= rest;
+            first++;
+            offset = 0;
+        }
+    }
+    if (::close(fd) != 0)
+        status = -1;
+#else
+    std::ofstream file(path, append ? std::ios::app : std::ios::out);
+    if (!file.is_open())
+        return -1;
+    for (auto part : parts)
+        file.write(part.data(), static_cast<std::streamsize>(part.size()));
+    file.close();
+    if (!file)
+        status = -1;
+#endif
+    flushed += held + buffer.size();
+    pieces.clear();
+    held = 0;
+    buffer.clear();
+    return status;
+}
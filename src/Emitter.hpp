@@ -0,0 +1,69 @@
+#pragma once
+
+#include <charconv>
+#include <concepts>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace k_13 {
+// Text built in memory and written to its file with one call. Generated code
+// and the table dumps are many small pieces, each of which costs a stream a
+// sentry and a virtual call; here they are appends to a string and integers
+// are formatted with to_chars. Emitters filled elsewhere, like the buffers of
+// generator threads, are taken over as pieces and written with writev.
+class Emitter {
+public:
+    Emitter() = default;
+    // text is handed to sink whenever more than limit bytes are held
+    Emitter(std::ostream *sink_, std::size_t limit_) : sink(sink_), limit(limit_) {}
+
+    Emitter &operator<<(std::string_view text) {
+        buffer.append(text);
+        return spill();
+    }
+    Emitter &operator<<(const std::string &text) { return *this << std::string_view(text); }
+    Emitter &operator<<(const char *text) { return *this << std::string_view(text); }
+    Emitter &operator<<(char ch) {
+        buffer += ch;
+        return spill();
+    }
+    // as a stream prints it, 1 or 0
+    Emitter &operator<<(bool value) { return *this << (value ? '1' : '0'); }
+    template <std::integral T>
+        requires (!std::same_as<T, char> && !std::same_as<T, signed char> && !std::same_as<T, unsigned char> && !std::same_as<T, bool>)
+    Emitter &operator<<(T value) {
+        char digits[24];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        buffer.append(digits, result.ptr);
+        return spill();
+    }
+    // appends the text of other without copying it
+    Emitter &operator<<(Emitter &&other);
+
+    // bytes emitted so far, including what went to the sink
+    std::size_t size() const { return flushed + held + buffer.size(); }
+    bool empty() const { return size() == 0; }
+    // hands what is held to the sink, or drops it when there is none. False when the sink failed
+    bool flush();
+    // writes what is held to path in one call and empties the emitter. 0 when it was written
+    int writeFile(const std::filesystem::path &path, bool append = false);
+
+private:
+    Emitter &spill() {
+        if (sink && held + buffer.size() > limit)
+            flush();
+        return *this;
+    }
+
+    std::ostream *sink = nullptr;
+    std::size_t limit = 0;
+    // taken over from other emitters, they come before buffer
+    std::vector<std::string> pieces;
+    std::size_t held = 0;
+    std::string buffer;
+    std::size_t flushed = 0;
+};
+} // k_13
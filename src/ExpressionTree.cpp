@@ -0,0 +1,197 @@
+#include "ExpressionTree.hpp"
+
+k_13::ExpressionNode k_13::ExpressionTree::parse(const std::vector<Lexem> &expression) {
+    code = &expression;
+    position = 0;
+    if (expression.empty())
+        return {};
+    return logical_expression();
+}
+
+std::vector<k_13::ExpressionNode> k_13::ExpressionTree::parseString(const std::vector<Lexem> &expression) {
+    std::vector<ExpressionNode> factors;
+    code = &expression;
+    position = 0;
+    if (expression.empty())
+        return factors;
+    factors.push_back(factor());
+    while (check(LexemType::ADD)) {
+        position++;
+        factors.push_back(factor());
+    }
+    return factors;
+}
+
+bool k_13::ExpressionTree::check(LexemType type) {
+    return position < code->size() && (*code)[position].type == type;
+}
+
+k_13::ExpressionNode k_13::ExpressionTree::binary(const Lexem &op, ExpressionNode &&left, ExpressionNode &&right) {
+    ExpressionNode node;
+    node.lexem = op;
+    node.operands.push_back(std::move(left));
+    node.operands.push_back(std::move(right));
+    return node;
+}
+
+// the grammar levels follow SyntaxAnalyzer, which match C++ operator precedence,
+// so the tree evaluates exactly like the generated code
+k_13::ExpressionNode k_13::ExpressionTree::logical_expression() {
+    ExpressionNode node = logical_term();
+    while (check(LexemType::OR)) {
+        Lexem op = (*code)[position++];
+        node = binary(op, std::move(node), logical_term());
+    }
+    return node;
+}
+
+k_13::ExpressionNode k_13::ExpressionTree::logical_term() {
+    ExpressionNode node = equality_expression();
+    while (check(LexemType::AND)) {
+        Lexem op = (*code)[position++];
+        node = binary(op, std::move(node), equality_expression());
+    }
+    return node;
+}
+
+k_13::ExpressionNode k_13::ExpressionTree::equality_expression() {
+    ExpressionNode node = relational_expression();
+    while (check(LexemType::EQUAL) || check(LexemType::NEQUAL)) {
+        Lexem op = (*code)[position++];
+        node = binary(op, std::move(node), relational_expression());
+    }
+    return node;
+}
+
+k_13::ExpressionNode k_13::ExpressionTree::relational_expression() {
+    ExpressionNode node = arithmetic_expression();
+    while (check(LexemType::LESS) || check(LexemType::GREATER)) {
+        Lexem op = (*code)[position++];
+        node = binary(op, std::move(node), arithmetic_expression());
+    }
+    return node;
+}
+
+k_13::ExpressionNode k_13::ExpressionTree::arithmetic_expression() {
+    ExpressionNode node = term();
+    while (check(LexemType::ADD) || check(LexemType::SUB)) {
+        Lexem op = (*code)[position++];
+        node = binary(op, std::move(node), term());
+    }
+    return node;
+}
+
+k_13::ExpressionNode k_13::ExpressionTree::term() {
+    ExpressionNode node = unary();
+    while (check(LexemType::MUL) || check(LexemType::DIV) || check(LexemType::MOD)) {
+        Lexem op = (*code)[position++];
+        node = binary(op, std::move(node), unary());
+    }
+    return node;
+}
+
+k_13::ExpressionNode k_13::ExpressionTree::unary() {
+    if (check(LexemType::NOT)) {
+        ExpressionNode node;
+        node.lexem = (*code)[position++];
+        node.operands.push_back(unary());
+        return node;
+    }
+    return factor();
+}
+
+k_13::ExpressionNode k_13::ExpressionTree::factor() {
+    ExpressionNode node;
+    if (position >= code->size())
+        return node;
+    if (check(LexemType::LPAREN)) {
+        position++;
+        node = logical_expression();
+        if (check(LexemType::RPAREN))
+            position++;
+        node.parentheses++;
+        return node;
+    }
+    node.lexem = (*code)[position++];
+    return node;
+}
+
+std::vector<k_13::Lexem> k_13::ExpressionTree::flatten(const ExpressionNode &node) {
+    std::vector<Lexem> result;
+    flatten(node, result);
+    return result;
+}
+
+std::vector<k_13::Lexem> k_13::ExpressionTree::flattenString(const std::vector<ExpressionNode> &factors) {
+    std::vector<Lexem> result;
+    for (size_t i = 0; i < factors.size(); i++) {
+        if (i > 0)
+            result.push_back({LexemType::ADD, "+", factors[i].lexem.line});
+        flatten(factors[i], result);
+    }
+    return result;
+}
+
+void k_13::ExpressionTree::flatten(const ExpressionNode &node, std::vector<Lexem> &result) {
+    for (int i = 0; i < node.parentheses; i++)
+        result.push_back({LexemType::LPAREN, "(", node.lexem.line});
+    if (node.operands.size() == 1) {
+        result.push_back(node.lexem);
+        flatten(node.operands.front(), result);
+    } else if (node.operands.size() == 2) {
+        flatten(node.operands.front(), result);
+        result.push_back(node.lexem);
+        flatten(node.operands.back(), result);
+    } else {
+        result.push_back(node.lexem);
+    }
+    for (int i = 0; i < node.parentheses; i++)
+        result.push_back({LexemType::RPAREN, ")", node.lexem.line});
+}
+
+bool k_13::ExpressionTree::isLogical(const ExpressionNode &node) {
+    switch (node.lexem.type) {
+    case LexemType::AND:
+    case LexemType::OR:
+    case LexemType::NOT:
+    case LexemType::EQUAL:
+    case LexemType::NEQUAL:
+    case LexemType::LESS:
+    case LexemType::GREATER:
+    case LexemType::TRUE:
+    case LexemType::FALSE:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool k_13::ExpressionTree::canTrap(const ExpressionNode &node) {
+    if ((node.lexem.type == LexemType::DIV || node.lexem.type == LexemType::MOD) && node.operands.size() == 2) {
+        const ExpressionNode &divisor = node.operands.back();
+        if (!isLeaf(divisor) || divisor.lexem.type != LexemType::NUMBER || divisor.lexem.constant == 0)
+            return true;
+    }
+    for (auto &operand : node.operands) {
+        if (canTrap(operand))
+            return true;
+    }
+    return false;
+}
+
+bool k_13::ExpressionTree::hasStringLiteral(const ExpressionNode &node) {
+    if (node.lexem.type == LexemType::STRING_LITERAL)
+        return true;
+    for (auto &operand : node.operands) {
+        if (hasStringLiteral(operand))
+            return true;
+    }
+    return false;
+}
+
+void k_13::ExpressionTree::collectIdentifiers(const ExpressionNode &node, std::vector<std::string> &identifiers) {
+    if (node.lexem.type == LexemType::IDENTIFIER)
+        identifiers.push_back(node.lexem.value);
+    for (auto &operand : node.operands)
+        collectIdentifiers(operand, identifiers);
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+#include <string>
+
+#include "constants.hpp"
+
+namespace k_13 {
+    struct ExpressionNode {
+        // operator token for inner nodes, operand token for leaves
+        Lexem lexem{};
+        // how many "(" ")" pairs surround the node in source
+        int parentheses = 0;
+        std::vector<ExpressionNode> operands{};
+    };
+
+class ExpressionTree {
+public:
+    ExpressionTree() = default;
+    ~ExpressionTree() = default;
+
+    // logical or arithmetic expression, as stored in Keyword::expression1/2
+    ExpressionNode parse(const std::vector<Lexem> &expression);
+    // string expression, top level "+" concatenates the factors
+    std::vector<ExpressionNode> parseString(const std::vector<Lexem> &expression);
+
+    static std::vector<Lexem> flatten(const ExpressionNode &node);
+    static std::vector<Lexem> flattenString(const std::vector<ExpressionNode> &factors);
+
+    static bool isLeaf(const ExpressionNode &node) { return node.operands.empty(); }
+    // result of the node is 0/1 rather than a number
+    static bool isLogical(const ExpressionNode &node);
+    // division or modulo by something that may be zero
+    static bool canTrap(const ExpressionNode &node);
+    static bool hasStringLiteral(const ExpressionNode &node);
+    static void collectIdentifiers(const ExpressionNode &node, std::vector<std::string> &identifiers);
+
+private:
+    ExpressionNode logical_expression();
+    ExpressionNode logical_term();
+    ExpressionNode equality_expression();
+    ExpressionNode relational_expression();
+    ExpressionNode arithmetic_expression();
+    ExpressionNode term();
+    ExpressionNode unary();
+    ExpressionNode factor();
+
+    ExpressionNode binary(const Lexem &op, ExpressionNode &&left, ExpressionNode &&right);
+    static void flatten(const ExpressionNode &node, std::vector<Lexem> &result);
+    bool check(LexemType type);
+
+    const std::vector<Lexem> *code = nullptr;
+    size_t position = 0;
+};
+} // k_13
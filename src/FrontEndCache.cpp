@@ -0,0 +1,407 @@
+#include "FrontEndCache.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <unordered_map>
+
+#include "Sha256.hpp"
+
+#ifdef _WIN32
+#define K13_MMAP 0
+#else
+#define K13_MMAP 1
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace {
+    // the modification time of a cached front end is its last use, eviction goes by it
+    void touch(const std::filesystem::path &file) {
+        std::error_code error;
+        std::filesystem::last_write_time(file, std::filesystem::file_time_type::clock::now(), error);
+    }
+
+    const char magic[4] = {'K', '1', '3', 'F'};
+    const std::uint32_t version = 1;
+    // written in the byte order of the machine, another order doesn't match
+    const std::uint32_t byteOrder = 0x01020304;
+
+    // word arrays of a file; a string is two words, offset and length in STRINGS
+    enum Section {
+        PROGRAM,            // program name
+        LEXEMS,             // type, value, line, constant
+        LITERALS,           // id, value
+        UNKNOWNS,           // id, value
+        IDENTIFIERS,        // name, first and count of IDENTIFIER_USES
+        IDENTIFIER_USES,    // line, expression type
+        LABELS,             // name, first and count of LABEL_USES
+        LABEL_USES,         // line, expression type
+        VARIABLES,          // name, type
+        EXPRESSIONS,        // type, first and count of EXPRESSION_LEXEMS
+        EXPRESSION_LEXEMS,  // as LEXEMS
+        KEYWORDS,           // see keywordWords
+        KEYWORD_LEXEMS,     // as LEXEMS
+        KEYWORD_VARIABLES,  // as VARIABLES
+        ROOT,               // first and count of the top-level KEYWORDS
+        STRINGS,            // bytes
+        SECTIONS
+    };
+    const std::size_t lexemWords = 5;
+    // type, expression1, expression2 (first, count), label, label2, label3,
+    // comp, keywords (first, count into KEYWORDS), variables
+    const std::size_t keywordWords = 17;
+    const std::size_t headerSize = 16 + 16 * SECTIONS;
+
+    class Writer {
+    public:
+        std::vector<std::uint32_t> sections[SECTIONS];
+        std::string strings;
+
+        // equal strings share their bytes in the pool
+        void string(std::vector<std::uint32_t> &out, const std::string &value) {
+            auto found = offsets.find(value);
+            std::uint32_t offset;
+            if (found != offsets.end()) {
+                offset = found->second;
+            }
+            else {
+                offset = static_cast<std::uint32_t>(strings.size());
+                strings += value;
+                offsets.emplace(value, offset);
+            }
+            out.push_back(offset);
+            out.push_back(static_cast<std::uint32_t>(value.size()));
+        }
+
+        void lexem(std::vector<std::uint32_t> &out, const k_13::Lexem &lexem) {
+            out.push_back(static_cast<std::uint32_t>(lexem.type));
+            string(out, lexem.value);
+            out.push_back(static_cast<std::uint32_t>(lexem.line));
+            out.push_back(static_cast<std::uint32_t>(lexem.constant));
+        }
+
+        // first and count in out, the lexems themselves in pool
+        void lexems(std::vector<std::uint32_t> &out, Section pool, const std::vector<k_13::Lexem> &values) {
+            out.push_back(static_cast<std::uint32_t>(sections[pool].size() / lexemWords));
+            out.push_back(static_cast<std::uint32_t>(values.size()));
+            for (auto &value : values)
+                lexem(sections[pool], value);
+        }
+
+        void variables(std::vector<std::uint32_t> &out, const std::map<std::string, k_13::LexemType> &values) {
+            for (auto &value : values) {
+                string(out, value.first);
+                out.push_back(static_cast<std::uint32_t>(value.second));
+            }
+        }
+
+        // siblings are side by side, their children follow them
+        std::uint32_t keywords(const std::vector<k_13::Keyword> &values) {
+            std::size_t first = sections[KEYWORDS].size();
+            sections[KEYWORDS].resize(first + values.size() * keywordWords);
+            for (std::size_t i = 0; i < values.size(); i++) {
+                const k_13::Keyword &keyword = values[i];
+                std::vector<std::uint32_t> words;
+                words.push_back(static_cast<std::uint32_t>(keyword.keyword));
+                lexems(words, KEYWORD_LEXEMS, keyword.expression1);
+                lexems(words, KEYWORD_LEXEMS, keyword.expression2);
+                string(words, keyword.label);
+                string(words, keyword.label2);
+                string(words, keyword.label3);
+                words.push_back(keywords(keyword.comp));
+                words.push_back(static_cast<std::uint32_t>(keyword.comp.size()));
+                words.push_back(keywords(keyword.keywords));
+                words.push_back(static_cast<std::uint32_t>(keyword.keywords.size()));
+                words.push_back(static_cast<std::uint32_t>(sections[KEYWORD_VARIABLES].size() / 3));
+                words.push_back(static_cast<std::uint32_t>(keyword.variables.size()));
+                variables(sections[KEYWORD_VARIABLES], keyword.variables);
+                std::copy(words.begin(), words.end(), sections[KEYWORDS].begin() + first + i * keywordWords);
+            }
+            return static_cast<std::uint32_t>(first / keywordWords);
+        }
+
+    private:
+        std::unordered_map<std::string, std::uint32_t> offsets;
+    };
+
+    class Reader {
+    public:
+        Reader(const char *data_, std::size_t size_) : data(data_), size(size_) {}
+
+        bool open() {
+            if (size < headerSize || std::memcmp(data, magic, 4) != 0 || word(data + 4) != version
+                || word(data + 8) != SECTIONS || word(data + 12) != byteOrder)
+                return false;
+            for (int i = 0; i < SECTIONS; i++) {
+                std::uint64_t offset, bytes;
+                std::memcpy(&offset, data + 16 + 16 * i, 8);
+                std::memcpy(&bytes, data + 24 + 16 * i, 8);
+                if (offset > size || bytes > size - offset || (i != STRINGS && bytes % 4 != 0))
+                    return false;
+                sections[i] = data + offset;
+                counts[i] = i == STRINGS ? bytes : bytes / 4;
+            }
+            return true;
+        }
+
+        std::uint32_t at(Section section, std::size_t index) const {
+            return index < counts[section] ? word(sections[section] + 4 * index) : 0;
+        }
+        std::size_t count(Section section) const { return counts[section]; }
+        // false when a reference points outside its section
+        bool valid = true;
+
+        std::string string(Section section, std::size_t index) {
+            std::uint32_t offset = at(section, index), length = at(section, index + 1);
+            if (offset > counts[STRINGS] || length > counts[STRINGS] - offset) {
+                valid = false;
+                return {};
+            }
+            return std::string(sections[STRINGS] + offset, length);
+        }
+
+        k_13::Lexem lexem(Section section, std::size_t index) {
+            std::size_t base = index * lexemWords;
+            return {static_cast<k_13::LexemType>(at(section, base)), string(section, base + 1),
+                static_cast<int>(at(section, base + 3)), static_cast<int>(at(section, base + 4))};
+        }
+
+        std::vector<k_13::Lexem> lexems(Section pool, std::uint32_t first, std::uint32_t number) {
+            std::vector<k_13::Lexem> result;
+            if (!range(pool, first, number, lexemWords))
+                return result;
+            result.reserve(number);
+            for (std::uint32_t i = 0; i < number; i++)
+                result.push_back(lexem(pool, first + i));
+            return result;
+        }
+
+        void variables(Section section, std::uint32_t first, std::uint32_t number, std::map<std::string, k_13::LexemType> &values) {
+            if (!range(section, first, number, 3))
+                return;
+            for (std::uint32_t i = first; i < first + number; i++)
+                values.emplace(string(section, 3 * i), static_cast<k_13::LexemType>(at(section, 3 * i + 2)));
+        }
+
+        // children come after their parent, so a damaged file can't loop
+        std::vector<k_13::Keyword> keywords(std::uint32_t first, std::uint32_t number, std::uint32_t parent) {
+            std::vector<k_13::Keyword> result;
+            if (number == 0)
+                return result;
+            if ((parent != UINT32_MAX && first <= parent) || !range(KEYWORDS, first, number, keywordWords)) {
+                valid = false;
+                return result;
+            }
+            result.resize(number);
+            for (std::uint32_t i = 0; i < number && valid; i++) {
+                std::uint32_t index = first + i;
+                std::size_t base = static_cast<std::size_t>(index) * keywordWords;
+                k_13::Keyword &keyword = result[i];
+                keyword.keyword = static_cast<k_13::LexemType>(at(KEYWORDS, base));
+                keyword.expression1 = lexems(KEYWORD_LEXEMS, at(KEYWORDS, base + 1), at(KEYWORDS, base + 2));
+                keyword.expression2 = lexems(KEYWORD_LEXEMS, at(KEYWORDS, base + 3), at(KEYWORDS, base + 4));
+                keyword.label = string(KEYWORDS, base + 5);
+                keyword.label2 = string(KEYWORDS, base + 7);
+                keyword.label3 = string(KEYWORDS, base + 9);
+                keyword.comp = keywords(at(KEYWORDS, base + 11), at(KEYWORDS, base + 12), index);
+                keyword.keywords = keywords(at(KEYWORDS, base + 13), at(KEYWORDS, base + 14), index);
+                variables(KEYWORD_VARIABLES, at(KEYWORDS, base + 15), at(KEYWORDS, base + 16), keyword.variables);
+            }
+            return result;
+        }
+
+        bool range(Section section, std::uint64_t first, std::uint64_t number, std::size_t words) {
+            if ((first + number) * words > counts[section]) {
+                valid = false;
+                return false;
+            }
+            return true;
+        }
+
+    private:
+        static std::uint32_t word(const char *at) {
+            std::uint32_t value;
+            std::memcpy(&value, at, 4);
+            return value;
+        }
+
+        const char *data;
+        std::size_t size;
+        const char *sections[SECTIONS]{};
+        std::size_t counts[SECTIONS]{};
+    };
+}
+
+std::string k_13::FrontEndCache::key(const std::string &source) const {
+    Sha256 hash;
+    hash.update("k13c front end " + std::to_string(version) + "\n");
+    hash.update(compiler + "\n");
+    hash.update(source);
+    return hash.hex();
+}
+
+int k_13::FrontEndCache::serialize(const FrontEnd &frontEnd, std::string &data) {
+    Writer writer;
+    auto &sections = writer.sections;
+    writer.string(sections[PROGRAM], frontEnd.programName);
+    for (auto &lexem : frontEnd.lexems)
+        writer.lexem(sections[LEXEMS], lexem);
+    for (auto &literal : frontEnd.literals) {
+        sections[LITERALS].push_back(static_cast<std::uint32_t>(literal.id));
+        writer.string(sections[LITERALS], literal.value);
+    }
+    for (auto &unknown : frontEnd.unknownLexems) {
+        sections[UNKNOWNS].push_back(static_cast<std::uint32_t>(unknown.id));
+        writer.string(sections[UNKNOWNS], unknown.value);
+    }
+    for (auto &identifier : frontEnd.identifiers) {
+        writer.string(sections[IDENTIFIERS], identifier.first);
+        sections[IDENTIFIERS].push_back(static_cast<std::uint32_t>(sections[IDENTIFIER_USES].size() / 2));
+        sections[IDENTIFIERS].push_back(static_cast<std::uint32_t>(identifier.second.size()));
+        for (auto &use : identifier.second) {
+            sections[IDENTIFIER_USES].push_back(static_cast<std::uint32_t>(use.first));
+            sections[IDENTIFIER_USES].push_back(static_cast<std::uint32_t>(use.second));
+        }
+    }
+    for (auto &label : frontEnd.labels) {
+        writer.string(sections[LABELS], label.first);
+        sections[LABELS].push_back(static_cast<std::uint32_t>(sections[LABEL_USES].size() / 2));
+        sections[LABELS].push_back(static_cast<std::uint32_t>(label.second.size()));
+        for (auto &use : label.second) {
+            sections[LABEL_USES].push_back(static_cast<std::uint32_t>(use.first));
+            sections[LABEL_USES].push_back(static_cast<std::uint32_t>(use.second));
+        }
+    }
+    writer.variables(sections[VARIABLES], frontEnd.variableTable);
+    for (auto &expression : frontEnd.expressions) {
+        sections[EXPRESSIONS].push_back(static_cast<std::uint32_t>(expression.first));
+        writer.lexems(sections[EXPRESSIONS], EXPRESSION_LEXEMS, expression.second);
+    }
+    std::uint32_t root = writer.keywords(frontEnd.keywords);
+    sections[ROOT].push_back(root);
+    sections[ROOT].push_back(static_cast<std::uint32_t>(frontEnd.keywords.size()));
+
+    data.assign(headerSize, '\0');
+    std::memcpy(data.data(), magic, 4);
+    std::uint32_t header[3] = {version, SECTIONS, byteOrder};
+    std::memcpy(data.data() + 4, header, sizeof(header));
+    for (int i = 0; i < SECTIONS; i++) {
+        // every section starts 8-byte aligned
+        data.resize((data.size() + 7) & ~std::size_t(7), '\0');
+        std::uint64_t offset = data.size();
+        std::uint64_t bytes;
+        if (i == STRINGS) {
+            data += writer.strings;
+            bytes = writer.strings.size();
+        }
+        else {
+            bytes = sections[i].size() * 4;
+            data.append(reinterpret_cast<const char *>(sections[i].data()), bytes);
+        }
+        std::memcpy(data.data() + 16 + 16 * i, &offset, 8);
+        std::memcpy(data.data() + 24 + 16 * i, &bytes, 8);
+    }
+    return data.size() > UINT32_MAX ? -1 : 0;
+}
+
+bool k_13::FrontEndCache::deserialize(const char *data, std::size_t size, FrontEnd &frontEnd) {
+    Reader reader(data, size);
+    if (!reader.open())
+        return false;
+    FrontEnd result;
+    result.programName = reader.string(PROGRAM, 0);
+    std::size_t lexems = reader.count(LEXEMS) / lexemWords;
+    result.lexems.reserve(lexems);
+    for (std::size_t i = 0; i < lexems; i++)
+        result.lexems.push_back(reader.lexem(LEXEMS, i));
+    for (std::size_t i = 0; i + 3 <= reader.count(LITERALS); i += 3)
+        result.literals.push_back({static_cast<int>(reader.at(LITERALS, i)), reader.string(LITERALS, i + 1)});
+    for (std::size_t i = 0; i + 3 <= reader.count(UNKNOWNS); i += 3)
+        result.unknownLexems.push_back({static_cast<int>(reader.at(UNKNOWNS, i)), reader.string(UNKNOWNS, i + 1)});
+    for (std::size_t i = 0; i + 4 <= reader.count(IDENTIFIERS); i += 4) {
+        auto &uses = result.identifiers[reader.string(IDENTIFIERS, i)];
+        std::uint32_t first = reader.at(IDENTIFIERS, i + 2), number = reader.at(IDENTIFIERS, i + 3);
+        if (reader.range(IDENTIFIER_USES, first, number, 2)) {
+            for (std::uint32_t use = first; use < first + number; use++)
+                uses.push_back({static_cast<int>(reader.at(IDENTIFIER_USES, 2 * use)), static_cast<ExpressionType>(reader.at(IDENTIFIER_USES, 2 * use + 1))});
+        }
+    }
+    for (std::size_t i = 0; i + 4 <= reader.count(LABELS); i += 4) {
+        auto &uses = result.labels[reader.string(LABELS, i)];
+        std::uint32_t first = reader.at(LABELS, i + 2), number = reader.at(LABELS, i + 3);
+        if (reader.range(LABEL_USES, first, number, 2)) {
+            for (std::uint32_t use = first; use < first + number; use++)
+                uses.push_back({static_cast<int>(reader.at(LABEL_USES, 2 * use)), static_cast<ExpressionType>(reader.at(LABEL_USES, 2 * use + 1))});
+        }
+    }
+    reader.variables(VARIABLES, 0, static_cast<std::uint32_t>(reader.count(VARIABLES) / 3), result.variableTable);
+    for (std::size_t i = 0; i + 3 <= reader.count(EXPRESSIONS); i += 3)
+        result.expressions.push_back({static_cast<LexemType>(reader.at(EXPRESSIONS, i)),
+            reader.lexems(EXPRESSION_LEXEMS, reader.at(EXPRESSIONS, i + 1), reader.at(EXPRESSIONS, i + 2))});
+    result.keywords = reader.keywords(reader.at(ROOT, 0), reader.at(ROOT, 1), UINT32_MAX);
+    if (!reader.valid)
+        return false;
+    frontEnd = std::move(result);
+    return true;
+}
+
+bool k_13::FrontEndCache::load(const std::string &key, FrontEnd &frontEnd) const {
+    std::filesystem::path file = directory / (key + ".k13f");
+#if K13_MMAP
+    int fd = ::open(file.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat status {};
+    if (fstat(fd, &status) != 0 || status.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+    std::size_t size = static_cast<std::size_t>(status.st_size);
+    void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+        return false;
+    bool loaded = deserialize(static_cast<const char *>(mapping), size, frontEnd);
+    munmap(mapping, size);
+    if (loaded)
+        touch(file);
+    return loaded;
+#else
+    std::ifstream input(file, std::ios::binary);
+    if (!input.is_open())
+        return false;
+    std::string data((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+    input.close();
+    bool loaded = deserialize(data.data(), data.size(), frontEnd);
+    if (loaded)
+        touch(file);
+    return loaded;
+#endif
+}
+
+int k_13::FrontEndCache::store(const std::string &key, const FrontEnd &frontEnd) const {
+    std::string data;
+    if (serialize(frontEnd, data) != 0)
+        return -1;
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    std::random_device random;
+    std::filesystem::path staging = directory / ("tmp-" + key.substr(0, 16) + "-" + std::to_string(random()));
+    std::ofstream file(staging, std::ios::binary);
+    file.write(data.data(), static_cast<std::streamsize>(data.size()));
+    file.close();
+    if (!file) {
+        std::filesystem::remove(staging, error);
+        return -1;
+    }
+    // another k13c may be loading the old entry, it keeps its mapping
+    std::filesystem::rename(staging, directory / (key + ".k13f"), error);
+    if (error) {
+        std::filesystem::remove(staging, error);
+        return -1;
+    }
+    return 0;
+}
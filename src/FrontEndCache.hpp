@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <list>
+#include <map>
+#include <cstdint>
+#include <filesystem>
+
+#include "constants.hpp"
+
+namespace k_13 {
+    // everything main takes from the lexer and the parser of a program that
+    // passed semantic analysis
+    struct FrontEnd {
+        std::string programName{};
+        std::vector<Lexem> lexems{};
+        std::vector<Literal> literals{};
+        std::vector<UnknownLexem> unknownLexems{};
+        std::map<std::string, std::vector<std::pair<int, ExpressionType>>> identifiers{};
+        std::map<std::string, std::list<std::pair<int, ExpressionType>>> labels{};
+        std::map<std::string, LexemType> variableTable{};
+        std::list<std::pair<LexemType, std::vector<Lexem>>> expressions{};
+        std::vector<Keyword> keywords{};
+    };
+
+// Stores FrontEnd in a binary file per source, named by the SHA-256 of the
+// source and of the compiler. A file is a header with the offset and size of
+// each section, followed by arrays of 32-bit words and a pool of string bytes
+// that the words point into. It is read straight from a memory mapping.
+class FrontEndCache {
+public:
+    FrontEndCache(std::filesystem::path directory_, std::string compiler_) : directory(std::move(directory_)), compiler(std::move(compiler_)) {}
+    ~FrontEndCache() = default;
+
+    // key of a source text
+    std::string key(const std::string &source) const;
+    // false when there is no usable entry
+    bool load(const std::string &key, FrontEnd &frontEnd) const;
+    // 0 when the entry was written
+    int store(const std::string &key, const FrontEnd &frontEnd) const;
+
+    static int serialize(const FrontEnd &frontEnd, std::string &data);
+    static bool deserialize(const char *data, std::size_t size, FrontEnd &frontEnd);
+
+private:
+    std::filesystem::path directory;
+    std::string compiler;
+};
+
+} // k_13
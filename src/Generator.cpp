@@ -1,26 +1,574 @@
 #include "Generator.hpp"
+#include "EmbeddedRuntime.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <exception>
+#include <thread>
+
+namespace {
+    // the pipe to g++ gets the code in blocks of this size
+    const std::size_t pipeBlock = 1 << 16;
+
+    // reads the state file of a resumable program: a line per number, strings
+    // as their size on a line followed by the bytes and a new line
+    const char *statePrelude =
+        "namespace {\n"
+        "class k13_state {\n"
+        "public:\n"
+        "explicit k13_state(const char *path) {\n"
+        "if (std::FILE *file = std::fopen(path, \"rb\")) {\n"
+        "char buffer[1 << 16];\n"
+        "std::size_t n;\n"
+        "while ((n = std::fread(buffer, 1, sizeof(buffer), file)) > 0)\n"
+        "data.append(buffer, n);\n"
+        "std::fclose(file);\n"
+        "}\n"
+        "}\n"
+        "std::string_view line() {\n"
+        "std::size_t end = data.find('\\n', position);\n"
+        "if (end == std::string::npos)\n"
+        "end = data.size();\n"
+        "std::string_view result(data.data() + position, end - position);\n"
+        "position = end < data.size() ? end + 1 : end;\n"
+        "return result;\n"
+        "}\n"
+        "long long number() {\n"
+        "std::string_view text = line();\n"
+        "long long value = 0;\n"
+        "std::from_chars(text.data(), text.data() + text.size(), value);\n"
+        "return value;\n"
+        "}\n"
+        "std::string_view bytes() {\n"
+        "std::size_t size = static_cast<std::size_t>(number());\n"
+        "if (size > data.size() - position)\n"
+        "size = data.size() - position;\n"
+        "std::string_view result(data.data() + position, size);\n"
+        "position += size < data.size() - position ? size + 1 : size;\n"
+        "return result;\n"
+        "}\n"
+        "private:\n"
+        "std::string data;\n"
+        "std::size_t position = 0;\n"
+        "};\n"
+        "}\n\n";
+
+    // characters of a literal without the quotes, an escape sequence counts as one
+    std::size_t literalLength(const std::string &literal) {
+        std::size_t length = 0;
+        for (std::size_t i = 1; i + 1 < literal.size(); i++) {
+            if (literal[i] == '\\')
+                i++;
+            length++;
+        }
+        return length;
+    }
+}
+
+// the escape sequences of C++ narrow string literals, as g++ reads them
+std::string k_13::Generator::decodeLiteral(const std::string &literal) {
+    std::string bytes;
+    std::size_t end = literal.size() - 1;
+    for (std::size_t i = 1; i < end; i++) {
+        if (literal[i] != '\\' || i + 1 >= end) {
+            bytes += literal[i];
+            continue;
+        }
+        char escape = literal[++i];
+        if (escape >= '0' && escape <= '7') {
+            // up to three octal digits
+            int value = escape - '0';
+            for (int digits = 1; digits < 3 && i + 1 < end && literal[i + 1] >= '0' && literal[i + 1] <= '7'; digits++)
+                value = value * 8 + (literal[++i] - '0');
+            bytes += static_cast<char>(value);
+            continue;
+        }
+        if (escape == 'x' && i + 1 < end && std::isxdigit(static_cast<unsigned char>(literal[i + 1]))) {
+            // as many hex digits as follow, the value is kept to a byte
+            unsigned value = 0;
+            while (i + 1 < end && std::isxdigit(static_cast<unsigned char>(literal[i + 1]))) {
+                char digit = literal[++i];
+                value = value * 16 + (std::isdigit(static_cast<unsigned char>(digit)) ? digit - '0' : std::tolower(digit) - 'a' + 10);
+            }
+            bytes += static_cast<char>(value & 0xff);
+            continue;
+        }
+        switch (escape) {
+        case 'n': bytes += '\n'; break;
+        case 't': bytes += '\t'; break;
+        case 'r': bytes += '\r'; break;
+        case 'a': bytes += '\a'; break;
+        case 'b': bytes += '\b'; break;
+        case 'f': bytes += '\f'; break;
+        case 'v': bytes += '\v'; break;
+        // \\ \" \' \? and unknown escapes stand for the character itself
+        default: bytes += escape; break;
+        }
+    }
+    return bytes;
+}
+
 
 int k_13::Generator::createCpp(const std::vector<Keyword> &keywords, const std::string &progName, const std::string &outPath, const std::vector<Literal> &literals_) {
     std::filesystem::path outputFile = outPath;
     outputFile /= (progName + ".cpp");
-    std::ofstream file(outputFile);
+    Emitter file;
+    poolLiterals(keywords, literals_);
+    layoutBlob();
+    units.clear();
+    emitted = 0;
+    std::vector<std::pair<std::size_t, std::size_t>> parts;
+    if (partition(keywords, parts)) {
+        if (split_gen(keywords, parts, progName, outPath, file) != 0)
+            return -1;
+    }
+    else
+        generate(keywords, file);
+    emitted += file.size();
+    if (file.writeFile(outputFile) != 0)
+        return -1;
+    return writeBlob(progName, outPath);
+}
 
-    if(!file.is_open()) {
+int k_13::Generator::streamCpp(const std::vector<Keyword> &keywords, const std::string &progName, const std::string &outPath, const std::vector<Literal> &literals_, std::ostream &out) {
+    Emitter file(&out, pipeBlock);
+    poolLiterals(keywords, literals_);
+    layoutBlob();
+    generate(keywords, file);
+    emitted = file.size();
+    if (!file.flush())
         return -1;
+    return writeBlob(progName, outPath);
+}
+
+void k_13::Generator::generate(const std::vector<Keyword> &keywords, Emitter &file) {
+    std::map<std::string, LexemType> identifiers;
+    std::set<std::string> definitions;
+    labelReferences.clear();
+    collectLabels(keywords, labelReferences, definitions);
+    includes_gen(file);
+    literals_gen(nullptr, file);
+    safePoints = 0;
+    if (options.resumable) {
+        resume_gen(keywords, file);
+        return;
     }
-    literals = literals_;
+    file << "\nint main()";
+    if (options.threads > 1 && keywords.size() == 1 && keywords.front().keyword == LexemType::START)
+        parallel_gen(keywords.front(), file);
+    else
+        statement_ch(keywords, identifiers, file);
+}
+
+// the statements of the program block in runs that threads generate into
+// buffers of their own, written out in order. Between two top-level statements
+// the generator keeps no state (hoisting ends with its loop, safe points are
+// only numbered in resumable programs), so the code is the same as serial.
+void k_13::Generator::parallel_gen(const Keyword &program, Emitter &file) {
+    auto &statements = program.keywords;
+    std::size_t total = countStatements(program);
+    std::size_t size = std::max<std::size_t>(parallelRun, total / (options.threads * 4));
+    std::vector<std::pair<std::size_t, std::size_t>> runs;
+    std::size_t first = 0;
+    std::size_t count = 0;
+    for (std::size_t i = 0; i < statements.size(); i++) {
+        count += countStatements(statements[i]);
+        if (count >= size) {
+            runs.push_back({first, i + 1});
+            first = i + 1;
+            count = 0;
+        }
+    }
+    if (first < statements.size())
+        runs.push_back({first, statements.size()});
     std::map<std::string, LexemType> identifiers;
-    file << "#include <iostream>\n"
-            "#include <string>\n"
-            "#include <sstream>\n\n"
-            "int main()";
-    statement_ch(keywords, identifiers, file);
-    file.close();
+    if (runs.size() < 2) {
+        compound_gen(program, identifiers, file);
+        return;
+    }
+    file << "{\n";
+    variables_gen(program, identifiers, file);
+
+    // every thread but this one works with a copy of the tables, made before any thread runs
+    std::size_t threads = std::min<std::size_t>(options.threads, runs.size());
+    std::vector<Generator> workers;
+    for (std::size_t i = 1; i < threads; i++)
+        workers.push_back(worker());
+    std::vector<Emitter> buffers(runs.size());
+    std::atomic<std::size_t> next = 0;
+    std::vector<std::exception_ptr> failures(threads);
+    auto work = [&](Generator &generator, std::exception_ptr &failure) {
+        try {
+            for (std::size_t run = next++; run < runs.size(); run = next++) {
+                std::map<std::string, LexemType> visible = identifiers;
+                generator.statement_ch(std::span<const Keyword>(statements).subspan(runs[run].first, runs[run].second - runs[run].first), visible, buffers[run]);
+            }
+        }
+        catch (...) {
+            failure = std::current_exception();
+            next = runs.size();
+        }
+    };
+    std::vector<std::thread> pool;
+    for (std::size_t i = 1; i < threads; i++)
+        pool.emplace_back(work, std::ref(workers[i - 1]), std::ref(failures[i]));
+    work(*this, failures[0]);
+    for (auto &thread : pool)
+        thread.join();
+    for (auto &failure : failures) {
+        if (failure)
+            std::rethrow_exception(failure);
+    }
+    for (auto &buffer : buffers)
+        file << std::move(buffer);
+    file << "}\n";
+}
+
+// a generator with the tables generation reads, for another thread
+k_13::Generator k_13::Generator::worker() const {
+    Generator copy;
+    copy.options = options;
+    copy.literals = literals;
+    copy.blobLiterals = blobLiterals;
+    copy.stringBounds = stringBounds;
+    copy.labelReferences = labelReferences;
+    copy.foreignLabels = foreignLabels;
+    return copy;
+}
+
+void k_13::Generator::includes_gen(Emitter &file) {
+    if (options.runtimeLibrary) {
+        // the precompiled header has to come first
+        file << "#include \"k13rt.hpp\"\n"
+             << (options.resumable ? "#include <cstdio>\n#include <charconv>\n" : "") << "\n";
+        return;
+    }
+    // runtime/k13rt.hpp and k13rt.cpp, embedded by the build
+    file << (options.resumable ? "#include <cstdio>\n" : "")
+         << runtimeHeader << "\n"
+         << runtimeSource << "\n";
+}
+
+// every distinct literal once, the code refers to it by name. used limits
+// them to the ids a translation unit refers to.
+void k_13::Generator::literals_gen(const std::set<std::string> *used, Emitter &file) {
+    bool blobDeclared = !used && !blob.empty();
+    if (blobDeclared)
+        file << "extern \"C\" const char k13_blob[];\n";
+    for (auto &literal : literals) {
+        if (used && !used->contains(std::to_string(literal.id)))
+            continue;
+        auto stored = blobLiterals.find(literal.id);
+        if (stored != blobLiterals.end()) {
+            if (!blobDeclared)
+                file << "extern \"C\" const char k13_blob[];\n";
+            blobDeclared = true;
+            file << "static const std::string_view k13_lit" << literal.id << "(k13_blob + " << stored->second.first
+                 << ", " << stored->second.second << ");\n";
+        }
+        else
+            // ""sv takes the length from the compiler, a constexpr strlen hits the constexpr loop limit
+            file << "static constexpr std::string_view k13_lit" << literal.id << " = " << literal.value << "sv;\n";
+    }
+}
+
+// the statements of the program block in runs of about partitionStatements,
+// cut between top-level statements. Every variable becomes one shared
+// variable, so a program is only split when that keeps its meaning.
+bool k_13::Generator::partition(const std::vector<Keyword> &keywords, std::vector<std::pair<std::size_t, std::size_t>> &parts) {
+    parts.clear();
+    if (options.partitionStatements == 0 || options.resumable || keywords.size() != 1 || keywords.front().keyword != LexemType::START)
+        return false;
+    std::map<std::string, LexemType> variables;
+    if (!collectVariables(keywords, variables) || reusesCounter(keywords, {}))
+        return false;
+    auto &statements = keywords.front().keywords;
+    std::size_t first = 0;
+    std::size_t size = 0;
+    for (std::size_t i = 0; i < statements.size(); i++) {
+        size += countStatements(statements[i]);
+        if (size >= options.partitionStatements) {
+            parts.push_back({first, i + 1});
+            first = i + 1;
+            size = 0;
+        }
+    }
+    if (first < statements.size())
+        parts.push_back({first, statements.size()});
+    return parts.size() > 1;
+}
+
+// the variables live in namespace k13_program, where every function sees them.
+// A goto to a label of another function returns the number of the label, and
+// main calls the function that defines it, which jumps there from its switch.
+// With the runtime library each function is a translation unit of its own,
+// the embedded helpers can't be shared so then they all stay in file.
+int k_13::Generator::split_gen(const std::vector<Keyword> &keywords, const std::vector<std::pair<std::size_t, std::size_t>> &parts,
+                               const std::string &progName, const std::string &outPath, Emitter &file) {
+    auto &statements = keywords.front().keywords;
+    std::map<std::string, LexemType> variables;
+    collectVariables(keywords, variables);
+    labelReferences.clear();
+    std::set<std::string> allDefinitions;
+    collectLabels(keywords, labelReferences, allDefinitions);
+    std::vector<std::vector<Keyword>> bodies;
+    std::vector<std::set<std::string>> definitions(parts.size());
+    std::map<std::string, std::size_t> owners;
+    std::map<std::string, int> numbers;
+    for (std::size_t part = 0; part < parts.size(); part++) {
+        bodies.emplace_back(statements.begin() + parts[part].first, statements.begin() + parts[part].second);
+        std::map<std::string, int> references;
+        collectLabels(bodies[part], references, definitions[part]);
+        for (auto &label : definitions[part])
+            owners[label] = part;
+        for (auto &reference : references) {
+            if (!definitions[part].contains(reference.first))
+                numbers[reference.first] = 0;
+        }
+    }
+    // label numbers start at 1, 0 is the end of a function
+    int number = 1;
+    for (auto &label : numbers)
+        label.second = number++;
+    bool separate = options.runtimeLibrary;
+
+    includes_gen(file);
+    if (!separate)
+        literals_gen(nullptr, file);
+    file << "\nnamespace k13_program {\n";
+    for (auto &variable : variables)
+        declaration_gen(variable.first, variable.second, file);
+    for (std::size_t part = 0; part < parts.size(); part++) {
+        if (separate)
+            file << "int k13_part_" << part << "(int k13_entry);\n";
+        else
+            part_gen(part, bodies[part], definitions[part], numbers, variables, file);
+    }
+    file << "}\n\n"
+            "static const int k13_label_part[] = {0";
+    for (auto &label : numbers)
+        file << ", " << owners[label.first];
+    file << "};\n"
+            "static int (*const k13_parts[])(int) = {";
+    for (std::size_t part = 0; part < parts.size(); part++)
+        file << (part ? ", " : "") << "k13_program::k13_part_" << part;
+    file << "};\n\n"
+            "int main() {\n"
+            "int k13_label = 0;\n"
+            "for (int k13_part = 0; k13_part < " << parts.size() << ";) {\n"
+            "k13_label = k13_parts[k13_part](k13_label);\n"
+            "k13_part = k13_label ? k13_label_part[k13_label] : k13_part + 1;\n"
+            "}\n"
+            "}\n";
+    if (!separate)
+        return 0;
+    for (std::size_t part = 0; part < parts.size(); part++) {
+        std::filesystem::path unitPath = std::filesystem::path(outPath) / (progName + "_part" + std::to_string(part) + ".cpp");
+        Emitter unit;
+        std::set<std::string> used;
+        collectLiterals(bodies[part], used);
+        includes_gen(unit);
+        literals_gen(&used, unit);
+        unit << "\nnamespace k13_program {\n";
+        for (auto &variable : variables) {
+            unit << "extern ";
+            declaration_gen(variable.first, variable.second, unit);
+        }
+        part_gen(part, bodies[part], definitions[part], numbers, variables, unit);
+        unit << "}\n";
+        emitted += unit.size();
+        if (unit.writeFile(unitPath) != 0)
+            return -1;
+        units.push_back(unitPath.string());
+    }
+    return 0;
+}
+
+void k_13::Generator::part_gen(std::size_t part, const std::vector<Keyword> &body, const std::set<std::string> &definitions,
+                               const std::map<std::string, int> &numbers, const std::map<std::string, LexemType> &variables, Emitter &file) {
+    file << "\nint k13_part_" << part << "(int k13_entry) {\n";
+    bool entries = false;
+    for (auto &label : numbers) {
+        if (!definitions.contains(label.first)) {
+            foreignLabels.insert(label);
+            continue;
+        }
+        if (!entries)
+            file << "switch (k13_entry) {\n";
+        entries = true;
+        file << "case " << label.second << ": goto " << label.first << ";\n";
+    }
+    if (entries)
+        file << "}\n";
+    // declared in the namespace, blocks only empty their strings
+    std::map<std::string, LexemType> identifiers = variables;
+    for (auto &variable : variables)
+        hoisted.insert(variable.first);
+    statement_ch(body, identifiers, file);
+    file << "return 0;\n"
+            "}\n";
+    hoisted.clear();
+    foreignLabels.clear();
+}
+
+// every variable is declared at the top of main, so a jump from the state
+// restore into any block skips no declaration. Blocks only empty their strings.
+void k_13::Generator::resume_gen(const std::vector<Keyword> &keywords, Emitter &file) {
+    std::map<std::string, LexemType> variables;
+    std::map<std::string, LexemType> identifiers;
+    std::set<std::string> definitions;
+    std::map<std::string, int> references;
+    collectVariables(keywords, variables);
+    collectLabels(keywords, references, definitions);
+    file << statePrelude << "\nint main(int argc, char *argv[]) {\n";
+    hoisted.clear();
+    for (auto &variable : variables) {
+        declaration_gen(variable.first, variable.second, file);
+        hoisted.insert(variable.first);
+    }
+    // values in the order of the names, then the input read ahead
+    file << "if (argc > 1) {\n"
+            "k13_state k13_resume(argv[1]);\n"
+            "std::string_view k13_at = k13_resume.line();\n";
+    for (auto &variable : variables) {
+        switch (variable.second) {
+        case LexemType::BOOL:
+            file << variable.first << " = k13_resume.number() != 0;\n";
+            break;
+        case LexemType::INT:
+            file << variable.first << " = static_cast<int16_t>(k13_resume.number());\n";
+            break;
+        case LexemType::NUMBER:
+            file << variable.first << " = static_cast<int>(k13_resume.number());\n";
+            break;
+        case LexemType::STRING:
+            file << variable.first << " = k13_resume.bytes();\n";
+            break;
+        default:
+            break;
+        }
+    }
+    file << "bool k13_failed = k13_resume.number() != 0;\n"
+            "k13_in.preload(k13_resume.bytes(), k13_failed);\n";
+    // the loops are numbered while the body is generated
+    Emitter body;
+    statement_ch(keywords, identifiers, body);
+    for (int i = 0; i < safePoints; i++)
+        file << "if (k13_at == \"k13_safe_" << i << "\") goto k13_safe_" << i << ";\n";
+    for (auto &label : definitions)
+        file << "if (k13_at == \"" << label << "\") goto " << label << ";\n";
+    file << "}\n"
+         << std::move(body) << "}\n";
+    hoisted.clear();
+}
+
+void k_13::Generator::poolLiterals(const std::vector<Keyword> &keywords, const std::vector<Literal> &literals_) {
+    std::set<std::string> used;
+    collectLiterals(keywords, used);
+    literals.clear();
+    for (auto &literal : literals_) {
+        if (used.contains(std::to_string(literal.id)))
+            literals.push_back(literal);
+    }
+}
+
+// literals over the threshold, each followed by a '\0' so data() stays a C string
+void k_13::Generator::layoutBlob() {
+    blobLiterals.clear();
+    blob.clear();
+    if (options.blobThreshold == 0)
+        return;
+    for (auto &literal : literals) {
+        std::string bytes = decodeLiteral(literal.value);
+        if (bytes.size() <= options.blobThreshold)
+            continue;
+        blobLiterals[literal.id] = {blob.size(), bytes.size()};
+        blob += bytes;
+        blob += '\0';
+    }
+}
+
+int k_13::Generator::writeBlob(const std::string &progName, const std::string &outPath) {
+    dataStub.clear();
+    if (blob.empty())
+        return 0;
+    std::filesystem::path blobFile = std::filesystem::absolute(outPath) / (progName + "_literals.bin");
+    std::filesystem::path stubFile = std::filesystem::path(outPath) / (progName + "_literals.S");
+    std::ofstream data(blobFile, std::ios::binary);
+    std::ofstream stub(stubFile);
+    if (!data.is_open() || !stub.is_open())
+        return -1;
+    data.write(blob.data(), static_cast<std::streamsize>(blob.size()));
+    stub << "/* string literals of " << progName << " */\n"
+            "    .section .rodata\n"
+            "    .globl k13_blob\n"
+            "k13_blob:\n"
+            "    .incbin \"" << blobFile.generic_string() << "\"\n"
+            "#if defined(__ELF__)\n"
+            "    .section .note.GNU-stack,\"\",%progbits\n"
+            "#endif\n";
+    dataStub = stubFile.string();
     return 0;
 }
 
-void k_13::Generator::statement_ch(const std::vector<Keyword> &keywords, std::map<std::string, LexemType> &identifiers, std::ofstream &file) {
-    for (auto keyword : keywords) {
+void k_13::Generator::streamBegin(Emitter &file) {
+    literals.clear();
+    blob.clear();
+    blobLiterals.clear();
+    dataStub.clear();
+    units.clear();
+    foreignLabels.clear();
+    hoisted.clear();
+    loopDepth = 0;
+    includes_gen(file);
+    file << "\nint main()";
+}
+
+void k_13::Generator::streamLiterals(const std::vector<Literal> &literals_, Emitter &file) {
+    literals = literals_;
+    literals_gen(nullptr, file);
+}
+
+void k_13::Generator::streamStatement(const Keyword &keyword, std::map<std::string, LexemType> &identifiers, Emitter &file) {
+    statement_ch(std::span<const Keyword>(&keyword, 1), identifiers, file);
+}
+
+void k_13::Generator::streamOpen(const Keyword &keyword, std::map<std::string, LexemType> &identifiers, Emitter &file) {
+    switch (keyword.keyword) {
+    case LexemType::START:
+        file << "{\n";
+        for (auto &var : keyword.variables)
+            declaration_gen(var.first, var.second, file);
+        break;
+    case LexemType::IF:
+        if_head_gen(keyword, file);
+        break;
+    case LexemType::FOR:
+        for_head_gen(keyword, identifiers, file);
+        file << "{\n";
+        break;
+    default:
+        break;
+    }
+}
+
+void k_13::Generator::streamClose(const Keyword &keyword, Emitter &file) {
+    switch (keyword.keyword) {
+    case LexemType::START:
+    case LexemType::FOR:
+        file << "}\n";
+        break;
+    case LexemType::IF:
+        if_tail_gen(keyword, file);
+        break;
+    default:
+        break;
+    }
+}
+
+void k_13::Generator::statement_ch(std::span<const Keyword> keywords, std::map<std::string, LexemType> &identifiers, Emitter &file) {
+    for (auto &keyword : keywords) {
         switch (keyword.keyword) {
         case LexemType::START:
             compound_gen(keyword, identifiers, file);
@@ -29,7 +577,7 @@ void k_13::Generator::statement_ch(const std::vector<Keyword> &keywords, std::ma
             assign_gen(keyword, identifiers, file);
             break;
         case LexemType::GET:
-            get_gen(keyword, file);
+            get_gen(keyword, identifiers, file);
             break;
         case LexemType::PUT:
             put_gen(keyword, file);
@@ -50,34 +598,61 @@ void k_13::Generator::statement_ch(const std::vector<Keyword> &keywords, std::ma
     }
 }
 
-void k_13::Generator::compound_gen(const Keyword &keyword, std::map<std::string, LexemType> &identifiers, std::ofstream &file) {
+void k_13::Generator::compound_gen(const Keyword &keyword, std::map<std::string, LexemType> &identifiers, Emitter &file) {
     std::map<std::string, LexemType> identifiers_comp = identifiers;
     file << "{\n";
-    for (auto var : keyword.variables) {
+    variables_gen(keyword, identifiers_comp, file);
+    statement_ch(keyword.keywords, identifiers_comp, file);
+    file << "}\n";
+}
+
+// the variables of a block, which become visible in identifiers
+void k_13::Generator::variables_gen(const Keyword &keyword, std::map<std::string, LexemType> &identifiers, Emitter &file) {
+    for (auto &var : keyword.variables) {
         switch (var.second) {
             case LexemType::BOOL:
-                file << "bool " << var.first << ";\n";
-                identifiers_comp[var.first] = LexemType::BOOL;
-                break;
             case LexemType::INT:
-                file << "int16_t " << var.first << ";\n";
-                identifiers_comp[var.first] = LexemType::INT;
-                break;
+            case LexemType::NUMBER:
             case LexemType::STRING:
-                file << "std::stringstream " << var.first << "_ss;\n";
-                file << "std::string " << var.first << ";\n";
-                identifiers_comp[var.first] = LexemType::STRING;
+                if (!hoisted.contains(var.first))
+                    declaration_gen(var.first, var.second, file);
+                else if (var.second == LexemType::STRING)
+                    // declared in front of the loop, a fresh string starts out empty
+                    file << var.first << ".clear();\n";
+                identifiers[var.first] = var.second;
                 break;
             default:
                 break;
         }
     }
-    statement_ch(keyword.keywords, identifiers_comp, file);
-    file << "}\n";
 }
 
-void k_13::Generator::assign_gen(const Keyword &keyword, std::map<std::string, LexemType> &identifiers, std::ofstream &file) {
+void k_13::Generator::declaration_gen(const std::string &name, LexemType type, Emitter &file) {
+    switch (type) {
+        case LexemType::BOOL:
+            file << "bool " << name << ";\n";
+            break;
+        case LexemType::INT:
+            file << "int16_t " << name << ";\n";
+            break;
+        case LexemType::NUMBER:
+            // optimizer temporary, keeps the int result of the promoted arithmetic
+            file << "int " << name << ";\n";
+            break;
+        case LexemType::STRING:
+            if (stringBounds.contains(name))
+                file << "k13_fixed<" << stringBounds.at(name) << "> " << name << ";\n";
+            else
+                file << "std::string " << name << ";\n";
+            break;
+        default:
+            break;
+    }
+}
+
+void k_13::Generator::assign_gen(const Keyword &keyword, std::map<std::string, LexemType> &identifiers, Emitter &file) {
     switch (identifiers.at(keyword.label)) {
+    case LexemType::NUMBER:
     case LexemType::INT:
         file << keyword.label << " = ";
         expression(keyword.expression1, file);
@@ -89,38 +664,238 @@ void k_13::Generator::assign_gen(const Keyword &keyword, std::map<std::string, L
         file << ";\n";
         break;
     case LexemType::STRING:
-        file << keyword.label << "_ss";
-        str_expression(keyword.expression1, file);
-        file << ";\n";
-        file << keyword.label << " = " << keyword.label << "_ss.str();\n";
-        file << keyword.label << "_ss.str(\"\");\n";
-        file << keyword.label << "_ss.clear();\n";
+        str_assign_gen(keyword, identifiers, file);
         break;
     default:
         break;
     }
 }
 
-void k_13::Generator::get_gen(const Keyword &keyword, std::ofstream &file) {
-    file << "std::cin >> " << keyword.label << ";\n";
+// the string is built in place from its factors. When the right side reads the
+// target, it is built in k13_scratch and swapped in, so both buffers are reused.
+// x := x + ... appends to x itself, so a loop of appends stays linear.
+void k_13::Generator::str_assign_gen(const Keyword &keyword, std::map<std::string, LexemType> &identifiers, Emitter &file) {
+    std::vector<std::vector<Lexem>> factors = str_factors(keyword.expression1);
+    if (factors.size() == 1 && factors.front().size() == 1) {
+        const Lexem &factor = factors.front().front();
+        if (factor.type == LexemType::STRING_LITERAL
+            || (factor.type == LexemType::IDENTIFIER && identifiers.at(factor.value) == LexemType::STRING)) {
+            file << keyword.label << " = " << (factor.type == LexemType::STRING_LITERAL ? "k13_lit" : "") << factor.value << ";\n";
+            return;
+        }
+    }
+    std::size_t first = 0;
+    if (factors.size() > 1 && factors.front().size() == 1 && factors.front().front().type == LexemType::IDENTIFIER
+        && factors.front().front().value == keyword.label)
+        first = 1;
+    bool readsTarget = false;
+    for (std::size_t i = first; i < factors.size(); i++) {
+        for (auto &exp : factors[i]) {
+            if (exp.type == LexemType::IDENTIFIER && exp.value == keyword.label)
+                readsTarget = true;
+        }
+    }
+    if (readsTarget)
+        first = 0;
+    std::string target = readsTarget ? "k13_scratch" : keyword.label;
+    // capacity known from the literals, plus the sizes of string variables
+    std::size_t reserved = 0;
+    std::string sizes;
+    for (std::size_t i = first; i < factors.size(); i++) {
+        auto &factor = factors[i];
+        if (factor.size() != 1) {
+            reserved += 11;
+            continue;
+        }
+        switch (factor.front().type) {
+        case LexemType::STRING_LITERAL:
+            reserved += literalLength(literalValue(factor.front().value));
+            break;
+        case LexemType::NUMBER:
+            reserved += std::to_string(factor.front().constant).size();
+            break;
+        case LexemType::TRUE:
+        case LexemType::FALSE:
+            reserved++;
+            break;
+        case LexemType::IDENTIFIER:
+            switch (identifiers.at(factor.front().value)) {
+            case LexemType::STRING:
+                sizes += " + " + factor.front().value + ".size()";
+                break;
+            case LexemType::BOOL:
+                reserved++;
+                break;
+            default:
+                reserved += 6;
+                break;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    // a fixed buffer is large enough for any value by construction
+    bool fixed = stringBounds.contains(target);
+    if (first == 0)
+        file << target << ".clear();\n";
+    if (!fixed) {
+        if (first == 0)
+            file << target << ".reserve(";
+        else
+            file << "k13_grow(" << target << ", ";
+        if (reserved > 0 || sizes.empty())
+            file << reserved << sizes << ");\n";
+        else
+            file << sizes.substr(3) << ");\n";
+    }
+    for (std::size_t i = first; i < factors.size(); i++) {
+        auto &factor = factors[i];
+        append_gen(target, factor, file);
+    }
+    if (readsTarget && stringBounds.contains(keyword.label))
+        file << keyword.label << " = k13_scratch;\n";
+    else if (readsTarget)
+        file << keyword.label << ".swap(k13_scratch);\n";
+}
+
+// splits a string expression at the "+" that concatenate
+std::vector<std::vector<k_13::Lexem>> k_13::Generator::str_factors(const std::vector<Lexem> &expressions) {
+    std::vector<std::vector<Lexem>> factors(1);
+    int depth = 0;
+    for (auto &exp : expressions) {
+        if (exp.type == LexemType::LPAREN)
+            depth++;
+        else if (exp.type == LexemType::RPAREN)
+            depth--;
+        if (exp.type == LexemType::ADD && depth == 0)
+            factors.emplace_back();
+        else
+            factors.back().push_back(exp);
+    }
+    return factors;
+}
+
+void k_13::Generator::append_gen(const std::string &target, const std::vector<Lexem> &factor, Emitter &file) {
+    file << "k13_append(" << target << ", ";
+    if (factor.size() == 1 && factor.front().type == LexemType::STRING_LITERAL)
+        file << "k13_lit" << factor.front().value;
+    else if (factor.size() == 1 && factor.front().type == LexemType::NUMBER)
+        file << "\"" << factor.front().constant << "\"";
+    else if (factor.size() == 1 && factor.front().type == LexemType::TRUE)
+        file << "\"1\"";
+    else if (factor.size() == 1 && factor.front().type == LexemType::FALSE)
+        file << "\"0\"";
+    else
+        expression(factor, file);
+    file << ");\n";
+}
+
+void k_13::Generator::get_gen(const Keyword &keyword, std::map<std::string, LexemType> &identifiers, Emitter &file) {
+    switch (identifiers.at(keyword.label)) {
+    case LexemType::INT:
+        file << keyword.label << " = k13_in.int16(" << keyword.label << ");\n";
+        break;
+    case LexemType::BOOL:
+        file << keyword.label << " = k13_in.boolean(" << keyword.label << ");\n";
+        break;
+    case LexemType::STRING:
+        file << "k13_in.string(" << keyword.label << ");\n";
+        break;
+    default:
+        break;
+    }
 }
 
-void k_13::Generator::put_gen(const Keyword &keyword, std::ofstream &file) {
-    file << "std::cout";
-    str_expression(keyword.expression1, file);
-    file << " << std::endl;\n";
+void k_13::Generator::put_gen(const Keyword &keyword, Emitter &file) {
+    for (auto &factor : str_factors(keyword.expression1))
+        append_gen("k13_out", factor, file);
+    file << "k13_out.push_back('\\n');\n";
+    if (options.interactive)
+        file << "k13_out.flush();\n";
 }
 
-void k_13::Generator::if_gen(const Keyword &keyword, std::map<std::string, LexemType> &identifiers, std::ofstream &file) {
+void k_13::Generator::if_gen(const Keyword &keyword, std::map<std::string, LexemType> &identifiers, Emitter &file) {
+    if_head_gen(keyword, file);
+    // optimizer drops the empty block, the jump to the next statement and unused label
+    if (!keyword.comp.empty())
+        compound_gen(keyword.comp.front(), identifiers, file);
+    if_tail_gen(keyword, file);
+}
+
+void k_13::Generator::if_head_gen(const Keyword &keyword, Emitter &file) {
     file << "if (";
     expression(keyword.expression1, file);
-    file << ") goto " << keyword.label << ";\n";
-    compound_gen(keyword.comp.front(), identifiers, file);
-    file << "goto " << keyword.label2 << ";\n";
-    file << keyword.label3 << ":\n";
+    file << ") ";
+    jump_gen(keyword.label, file);
+}
+
+void k_13::Generator::if_tail_gen(const Keyword &keyword, Emitter &file) {
+    if (!keyword.label2.empty())
+        jump_gen(keyword.label2, file);
+    if (!keyword.label3.empty())
+        file << keyword.label3 << ":;\n";
 }
 // need table of declared vars
-void k_13::Generator::for_gen(const Keyword &keyword, std::map<std::string, LexemType> &identifiers, std::ofstream &file) {
+void k_13::Generator::for_gen(const Keyword &keyword, std::map<std::string, LexemType> &identifiers, Emitter &file) {
+    if (options.resumable) {
+        // spelled out with labels, the loop head is where a resumed run continues
+        int loop = safePoints++;
+        file << keyword.label << " = ";
+        expression(keyword.expression1, file);
+        file << ";\n"
+             << "k13_safe_" << loop << ":\n"
+             << "if (!(" << keyword.label << " < ";
+        expression(keyword.expression2, file);
+        file << ")) goto k13_next_" << loop << ";\n";
+        compound_gen(keyword, identifiers, file);
+        file << keyword.label << "++;\n"
+             << "goto k13_safe_" << loop << ";\n"
+             << "k13_next_" << loop << ":;\n";
+        return;
+    }
+    std::map<std::string, LexemType> declarations;
+    if (options.hoistDeclarations && loopDepth == 0) {
+        // a jump from outside into the loop must not skip the hoisted declarations
+        std::map<std::string, int> references;
+        std::set<std::string> definitions;
+        collectLabels(keyword.keywords, references, definitions);
+        bool enteredFromOutside = false;
+        for (auto &label : definitions) {
+            if (labelReferences[label] > references[label])
+                enteredFromOutside = true;
+        }
+        if (!enteredFromOutside) {
+            std::set<std::string> excluded;
+            std::set<std::string> enclosing;
+            for (auto &identifier : identifiers)
+                enclosing.insert(identifier.first);
+            collectDeclarations(keyword, declarations, excluded, enclosing);
+            for (auto &name : excluded)
+                declarations.erase(name);
+            // a split program declares them all in its namespace
+            for (auto &name : hoisted)
+                declarations.erase(name);
+        }
+    }
+    if (!declarations.empty()) {
+        file << "{\n";
+        for (auto &declaration : declarations) {
+            declaration_gen(declaration.first, declaration.second, file);
+            hoisted.insert(declaration.first);
+        }
+    }
+    loopDepth++;
+    for_head_gen(keyword, identifiers, file);
+    compound_gen(keyword, identifiers, file);
+    loopDepth--;
+    if (!declarations.empty()) {
+        file << "}\n";
+        hoisted.clear();
+    }
+}
+
+void k_13::Generator::for_head_gen(const Keyword &keyword, std::map<std::string, LexemType> &identifiers, Emitter &file) {
     file << "for (";
     if (identifiers.find(keyword.label) != identifiers.end())
         file << keyword.label << "=";
@@ -130,48 +905,70 @@ void k_13::Generator::for_gen(const Keyword &keyword, std::map<std::string, Lexe
     file  << "; " << keyword.label << "<";
     expression(keyword.expression2, file);
     file << "; " << keyword.label << "++) ";
-    compound_gen(keyword, identifiers, file);
 }
 
-void k_13::Generator::goto_gen(const Keyword &keyword, std::ofstream &file) {
-    file << "goto " << keyword.label << ";\n";
+void k_13::Generator::goto_gen(const Keyword &keyword, Emitter &file) {
+    jump_gen(keyword.label, file);
 }
 
-void k_13::Generator::label_gen(const Keyword &keyword, std::ofstream &file) {
-    file << keyword.label << ":\n";
+void k_13::Generator::jump_gen(const std::string &label, Emitter &file) {
+    auto foreign = foreignLabels.find(label);
+    if (foreign != foreignLabels.end())
+        file << "return " << foreign->second << ";\n";
+    else
+        file << "goto " << label << ";\n";
 }
 
-void k_13::Generator::str_expression(const std::vector<Lexem> &expressions, std::ofstream &file) {
-    bool hasLP = false;
-    int depth = 0;
-    for (auto exp : expressions) {
+void k_13::Generator::label_gen(const Keyword &keyword, Emitter &file) {
+    // null statement keeps the label valid when it closes a block
+    file << keyword.label << ":;\n";
+}
+
+// operand of a "+", the parentheses around it aside
+bool k_13::Generator::concatenated(const std::vector<Lexem> &expressions, std::size_t index) {
+    std::size_t before = index;
+    while (before > 0 && expressions[before - 1].type == LexemType::LPAREN)
+        before--;
+    std::size_t after = index + 1;
+    while (after < expressions.size() && expressions[after].type == LexemType::RPAREN)
+        after++;
+    return (before > 0 && expressions[before - 1].type == LexemType::ADD)
+        || (after < expressions.size() && expressions[after].type == LexemType::ADD);
+}
+
+// the literals are ordered by id, a streamed program only has those of the current statement
+const std::string &k_13::Generator::literalValue(const std::string &id) {
+    int key = std::stoi(id);
+    return std::lower_bound(literals.begin(), literals.end(), key,
+                            [](const Literal &literal, int key) { return literal.id < key; })->value;
+}
+
+void k_13::Generator::expression(const std::vector<Lexem> &expressions, Emitter &file) {
+    for (std::size_t i = 0; i < expressions.size(); i++) {
+        const Lexem &exp = expressions[i];
         switch (exp.type) {
         case LexemType::LPAREN:
-            if (!hasLP)
-                file << "<< ";
-            hasLP = true;
-            depth++;
             file << "(";
             break;
         case LexemType::RPAREN:
-            depth--;
-            (depth > 0) ? hasLP = true : hasLP = false;
             file << ")";
             break;
         case LexemType::NUMBER:
-            if (!hasLP)
-                file << "<< ";
             file << exp.constant;
             break;
         case LexemType::IDENTIFIER:
-            if (!hasLP)
-                file << "<< ";
-            file << exp.value;
+            // compares like the std::string it replaces, and is one where it
+            // is concatenated, since string_view has no operator+
+            if (!stringBounds.contains(exp.value))
+                file << exp.value;
+            else if (concatenated(expressions, i))
+                file << "std::string(" << exp.value << ".view())";
+            else
+                file << exp.value << ".view()";
             break;
         case LexemType::STRING_LITERAL:
-            if (!hasLP)
-                file << "<< ";
-            file << literals[std::stoi(exp.value)-1].value;
+            // a literal in an int or bool expression is a pointer, as it was before interning
+            file << "k13_lit" << exp.value << ".data()";
             break;
         case LexemType::TRUE:
             file << "true";
@@ -180,8 +977,7 @@ void k_13::Generator::str_expression(const std::vector<Lexem> &expressions, std:
             file << "false";
             break;
         case LexemType::ADD:
-            if (hasLP)
-                file << "+";
+            file << "+";
             break;
         case LexemType::SUB:
             file << "-";
@@ -216,72 +1012,151 @@ void k_13::Generator::str_expression(const std::vector<Lexem> &expressions, std:
         case LexemType::GREATER:
             file << ">";
             break;
-        default:
-            break;
         }
     }
 }
-
-void k_13::Generator::expression(const std::vector<Lexem> &expressions, std::ofstream &file) {
-    for (auto exp : expressions) {
-        switch (exp.type) {
-        case LexemType::LPAREN:
-            file << "(";
-            break;
-        case LexemType::RPAREN:
-            file << ")";
-            break;
-        case LexemType::NUMBER:
-            file << exp.constant;
-            break;
-        case LexemType::IDENTIFIER:
-            file << exp.value;
+// variables of the loop and of every block inside it. A name is excluded when
+// one variable would stand for two that are alive at the same time: it shadows
+// a visible variable, it is declared with another type elsewhere in the loop,
+// or it is a loop counter.
+void k_13::Generator::collectDeclarations(const Keyword &keyword, std::map<std::string, LexemType> &declarations
+                                          , std::set<std::string> &excluded, std::set<std::string> enclosing) {
+    if (keyword.keyword == LexemType::FOR)
+        excluded.insert(keyword.label);
+    for (auto &var : keyword.variables) {
+        auto declared = declarations.find(var.first);
+        if (enclosing.contains(var.first) || (declared != declarations.end() && declared->second != var.second))
+            excluded.insert(var.first);
+        declarations[var.first] = var.second;
+    }
+    for (auto &var : keyword.variables)
+        enclosing.insert(var.first);
+    for (auto &statement : keyword.keywords) {
+        switch (statement.keyword) {
+        case LexemType::START:
+        case LexemType::FOR:
+            collectDeclarations(statement, declarations, excluded, enclosing);
             break;
-        case LexemType::STRING_LITERAL:
-            file << literals[std::stoi(exp.value)-1].value;
+        case LexemType::IF:
+            if (!statement.comp.empty())
+                collectDeclarations(statement.comp.front(), declarations, excluded, enclosing);
             break;
-        case LexemType::TRUE:
-            file << "true";
+        default:
             break;
-        case LexemType::FALSE:
-            file << "false";
+        }
+    }
+}
+
+void k_13::Generator::collectLabels(const std::vector<Keyword> &keywords, std::map<std::string, int> &references, std::set<std::string> &definitions) {
+    for (auto &keyword : keywords) {
+        switch (keyword.keyword) {
+        case LexemType::GOTO:
+            references[keyword.label]++;
             break;
-        case LexemType::ADD:
-            file << "+";
+        case LexemType::LABEL:
+            definitions.insert(keyword.label);
             break;
-        case LexemType::SUB:
-            file << "-";
+        case LexemType::IF:
+            references[keyword.label]++;
+            if (!keyword.label2.empty())
+                references[keyword.label2]++;
+            if (!keyword.label3.empty())
+                definitions.insert(keyword.label3);
+            if (!keyword.comp.empty())
+                collectLabels(keyword.comp.front().keywords, references, definitions);
             break;
-        case LexemType::MUL:
-            file << "*";
+        case LexemType::START:
+        case LexemType::FOR:
+            collectLabels(keyword.keywords, references, definitions);
             break;
-        case LexemType::DIV:
-            file << "/";
+        default:
             break;
-        case LexemType::MOD:
-            file << "%";
+        }
+    }
+}
+
+// false when a name is declared with two types, one variable can't stand for both
+bool k_13::Generator::collectVariables(const std::vector<Keyword> &keywords, std::map<std::string, LexemType> &variables) {
+    bool unique = true;
+    auto declare = [&](const std::string &name, LexemType type) {
+        auto declared = variables.insert({name, type});
+        if (!declared.second && declared.first->second != type)
+            unique = false;
+    };
+    for (auto &keyword : keywords) {
+        switch (keyword.keyword) {
+        case LexemType::START:
+            for (auto &var : keyword.variables)
+                declare(var.first, var.second);
+            unique = collectVariables(keyword.keywords, variables) && unique;
             break;
-        case LexemType::AND:
-            file << "&&";
+        case LexemType::FOR:
+            for (auto &var : keyword.variables)
+                declare(var.first, var.second);
+            // the counter of a loop may be used without a declaration
+            declare(keyword.label, LexemType::INT);
+            unique = collectVariables(keyword.keywords, variables) && unique;
             break;
-        case LexemType::OR:
-            file << "||";
+        case LexemType::IF:
+            if (!keyword.comp.empty()) {
+                for (auto &var : keyword.comp.front().variables)
+                    declare(var.first, var.second);
+                unique = collectVariables(keyword.comp.front().keywords, variables) && unique;
+            }
             break;
-        case LexemType::NOT:
-            file << "!";
+        default:
             break;
-        case LexemType::EQUAL:
-            file << "==";
+        }
+    }
+    return unique;
+}
+
+// a loop inside a loop with the same counter has a counter of its own
+bool k_13::Generator::reusesCounter(const std::vector<Keyword> &keywords, std::set<std::string> counters) {
+    for (auto &keyword : keywords) {
+        switch (keyword.keyword) {
+        case LexemType::START:
+            if (reusesCounter(keyword.keywords, counters))
+                return true;
             break;
-        case LexemType::NEQUAL:
-            file << "!=";
+        case LexemType::FOR: {
+            if (counters.contains(keyword.label))
+                return true;
+            std::set<std::string> inner = counters;
+            inner.insert(keyword.label);
+            if (reusesCounter(keyword.keywords, inner))
+                return true;
             break;
-        case LexemType::LESS:
-            file << "<";
+        }
+        case LexemType::IF:
+            if (!keyword.comp.empty() && reusesCounter(keyword.comp.front().keywords, counters))
+                return true;
             break;
-        case LexemType::GREATER:
-            file << ">";
+        default:
             break;
         }
     }
-}
\ No newline at end of file
+    return false;
+}
+
+void k_13::Generator::collectLiterals(const std::vector<Keyword> &keywords, std::set<std::string> &used) {
+    for (auto &keyword : keywords) {
+        for (auto *expression : {&keyword.expression1, &keyword.expression2}) {
+            for (auto &lexem : *expression) {
+                if (lexem.type == LexemType::STRING_LITERAL)
+                    used.insert(lexem.value);
+            }
+        }
+        collectLiterals(keyword.keywords, used);
+        collectLiterals(keyword.comp, used);
+    }
+}
+
+std::size_t k_13::Generator::countStatements(const Keyword &keyword) {
+    std::size_t count = 1;
+    for (auto &statement : keyword.keywords)
+        count += countStatements(statement);
+    for (auto &statement : keyword.comp)
+        count += countStatements(statement);
+    return count;
+}
@@ -6,32 +6,138 @@
 #include <iostream>
 #include <map>
 #include <list>
+#include <set>
+#include <span>
 
 #include "constants.hpp"
+#include "Emitter.hpp"
 
 namespace k_13 {
+    struct GeneratorOptions {
+        // declare the variables of blocks inside a for loop once in front of the
+        // outermost loop instead of on every iteration
+        bool hoistDeclarations = true;
+        // literals longer than this many bytes go to a binary file linked in
+        // through an assembler stub, 0 keeps every literal in the source
+        std::size_t blobThreshold = 0;
+        // flush the output after every put instead of in large blocks
+        bool interactive = false;
+        // main(argc, argv) can continue at a for loop head or a label with the
+        // variables and pending input of the state file named by argv[1]
+        bool resumable = false;
+        // include k13rt.hpp and link the prebuilt k13rt_cpp library instead of
+        // putting the helpers into every program
+        bool runtimeLibrary = false;
+        // cut the program into functions of about this many statements, each
+        // in its own translation unit when the runtime library is used; 0 keeps
+        // the whole program in main
+        std::size_t partitionStatements = 0;
+        // threads that generate the top-level statements of a large program,
+        // the code is the same with any number
+        unsigned threads = 1;
+    };
+
 class Generator {
 public:
     Generator() = default;
     ~Generator() = default;
 
     int createCpp(const std::vector<Keyword> &keywords, const std::string &progName, const std::string &outPath, const std::vector<Literal> &literals_);
+    // like createCpp, but the code goes to file as it is generated, only the literal blob is written to outPath
+    int streamCpp(const std::vector<Keyword> &keywords, const std::string &progName, const std::string &outPath, const std::vector<Literal> &literals_, std::ostream &out);
+    void setOptions(const GeneratorOptions &options_) { options = options_; }
+    const GeneratorOptions &getOptions() const { return options; }
+    // strings with a known maximum length, declared as fixed buffers
+    void setStringBounds(const std::map<std::string, std::size_t> &bounds) { stringBounds = bounds; }
+    // assembler stub of the literal blob written by createCpp, empty if there is none
+    const std::string &getDataStub() { return dataStub; }
+    // bytes of the literals in the blob, empty if there is none
+    const std::string &getBlob() { return blob; }
+    // the other translation units createCpp wrote for a split program, empty if there are none
+    const std::vector<std::string> &getUnits() const { return units; }
+    // bytes of C++ the last createCpp or streamCpp wrote, the other translation units included
+    std::size_t getEmitted() const { return emitted; }
+    // bytes the C++ compiler would make of a literal
+    static std::string decodeLiteral(const std::string &literal);
+
+    // code of a program that is compiled while it is read: the includes and
+    // main, then each statement as it comes, blocks written as a head before
+    // their statements and a tail after them. Nothing is optimized.
+    void streamBegin(Emitter &file);
+    // literals of the statement written next
+    void streamLiterals(const std::vector<Literal> &literals_, Emitter &file);
+    void streamStatement(const Keyword &keyword, std::map<std::string, LexemType> &identifiers, Emitter &file);
+    // head of a start, if or for whose statements follow
+    void streamOpen(const Keyword &keyword, std::map<std::string, LexemType> &identifiers, Emitter &file);
+    void streamClose(const Keyword &keyword, Emitter &file);
 
 private:
-    void statement_ch(const std::vector<Keyword> &keywords, std::map<std::string, LexemType> &identifiers, std::ofstream &file);
-    void compound_gen(const Keyword &keyword, std::map<std::string, LexemType> &identifiers, std::ofstream &file);
-    void assign_gen(const Keyword &keyword, std::map<std::string, LexemType> &identifiers, std::ofstream &file);
-    void get_gen(const Keyword &keyword, std::ofstream &file);
-    void put_gen(const Keyword &keyword, std::ofstream &file);
-    void if_gen(const Keyword &keyword, std::map<std::string, LexemType> &identifiers, std::ofstream &file);
-    void for_gen(const Keyword &keyword, std::map<std::string, LexemType> &identifiers, std::ofstream &file);
-    void goto_gen(const Keyword &keyword, std::ofstream &file);
-    void label_gen(const Keyword &keyword, std::ofstream &file);
-
-    void expression(const std::vector<Lexem> &expressions, std::ofstream &file);
-    void str_expression(const std::vector<Lexem> &expressions, std::ofstream &file);
+    void generate(const std::vector<Keyword> &keywords, Emitter &file);
+    void includes_gen(Emitter &file);
+    void literals_gen(const std::set<std::string> *used, Emitter &file);
+    bool partition(const std::vector<Keyword> &keywords, std::vector<std::pair<std::size_t, std::size_t>> &parts);
+    int split_gen(const std::vector<Keyword> &keywords, const std::vector<std::pair<std::size_t, std::size_t>> &parts,
+                  const std::string &progName, const std::string &outPath, Emitter &file);
+    void part_gen(std::size_t part, const std::vector<Keyword> &body, const std::set<std::string> &definitions,
+                  const std::map<std::string, int> &numbers, const std::map<std::string, LexemType> &variables, Emitter &file);
+    // literals the statements still use, the optimizer may have removed the others
+    void poolLiterals(const std::vector<Keyword> &keywords, const std::vector<Literal> &literals_);
+    void layoutBlob();
+    int writeBlob(const std::string &progName, const std::string &outPath);
+    void parallel_gen(const Keyword &program, Emitter &file);
+    Generator worker() const;
+    void statement_ch(std::span<const Keyword> keywords, std::map<std::string, LexemType> &identifiers, Emitter &file);
+    void compound_gen(const Keyword &keyword, std::map<std::string, LexemType> &identifiers, Emitter &file);
+    void variables_gen(const Keyword &keyword, std::map<std::string, LexemType> &identifiers, Emitter &file);
+    void assign_gen(const Keyword &keyword, std::map<std::string, LexemType> &identifiers, Emitter &file);
+    void str_assign_gen(const Keyword &keyword, std::map<std::string, LexemType> &identifiers, Emitter &file);
+    void append_gen(const std::string &target, const std::vector<Lexem> &factor, Emitter &file);
+    void get_gen(const Keyword &keyword, std::map<std::string, LexemType> &identifiers, Emitter &file);
+    void put_gen(const Keyword &keyword, Emitter &file);
+    void if_gen(const Keyword &keyword, std::map<std::string, LexemType> &identifiers, Emitter &file);
+    void if_head_gen(const Keyword &keyword, Emitter &file);
+    void if_tail_gen(const Keyword &keyword, Emitter &file);
+    void for_head_gen(const Keyword &keyword, std::map<std::string, LexemType> &identifiers, Emitter &file);
+    void for_gen(const Keyword &keyword, std::map<std::string, LexemType> &identifiers, Emitter &file);
+    void goto_gen(const Keyword &keyword, Emitter &file);
+    void jump_gen(const std::string &label, Emitter &file);
+    void label_gen(const Keyword &keyword, Emitter &file);
+    void declaration_gen(const std::string &name, LexemType type, Emitter &file);
+
+    void collectDeclarations(const Keyword &keyword, std::map<std::string, LexemType> &declarations
+                             , std::set<std::string> &excluded, std::set<std::string> enclosing);
+    void collectLabels(const std::vector<Keyword> &keywords, std::map<std::string, int> &references, std::set<std::string> &definitions);
+    bool collectVariables(const std::vector<Keyword> &keywords, std::map<std::string, LexemType> &variables);
+    bool reusesCounter(const std::vector<Keyword> &keywords, std::set<std::string> counters);
+    void collectLiterals(const std::vector<Keyword> &keywords, std::set<std::string> &used);
+    static std::size_t countStatements(const Keyword &keyword);
+    void resume_gen(const std::vector<Keyword> &keywords, Emitter &file);
+
+    void expression(const std::vector<Lexem> &expressions, Emitter &file);
+    static bool concatenated(const std::vector<Lexem> &expressions, std::size_t index);
+    const std::string &literalValue(const std::string &id);
+    std::vector<std::vector<Lexem>> str_factors(const std::vector<Lexem> &expressions);
 
     std::vector<Literal> literals;
+    GeneratorOptions options;
+    // offset and length in the blob of each literal stored there
+    std::map<int, std::pair<std::size_t, std::size_t>> blobLiterals;
+    std::string blob;
+    std::string dataStub;
+    std::vector<std::string> units;
+    std::size_t emitted = 0;
+    // labels of other functions of a split program, a jump returns the number to main
+    std::map<std::string, int> foreignLabels;
+    std::map<std::string, std::size_t> stringBounds;
+    // labels jumped to anywhere in the program
+    std::map<std::string, int> labelReferences;
+    // declared in front of the loop being generated
+    std::set<std::string> hoisted;
+    int loopDepth = 0;
+    // loops generated so far, the head of loop N is the label k13_safe_N
+    int safePoints = 0;
+    // fewest statements a thread of parallel_gen is given at once
+    static constexpr std::size_t parallelRun = 256;
 
 };
 
@@ -0,0 +1,392 @@
+#include "Jit.hpp"
+
+#include <algorithm>
+#include <charconv>
+
+#if defined(__linux__) && defined(__x86_64__)
+#include <sys/mman.h>
+#define K13_JIT 1
+#else
+#define K13_JIT 0
+#endif
+
+namespace {
+    // what the helpers called from generated code work on
+    struct JitState {
+        std::int64_t *r = nullptr;
+        std::vector<std::string> s{};
+        const std::vector<std::string> *literals = nullptr;
+        std::istream *in = nullptr;
+        std::ostream *out = nullptr;
+        std::string output{};
+        bool interactive = false;
+    };
+
+    void flush(JitState &state) {
+        state.out->write(state.output.data(), static_cast<std::streamsize>(state.output.size()));
+        state.output.clear();
+    }
+
+    const std::string &text(JitState *state, int operand) {
+        return operand < 0 ? (*state->literals)[-operand - 1] : state->s[operand];
+    }
+
+    // helpers have the same signature, so every call is set up alike
+    std::int64_t strClear(JitState *state, int a, int, int) {
+        state->s[a].clear();
+        return 0;
+    }
+
+    std::int64_t strAppend(JitState *state, int a, int b, int) {
+        state->s[a].append(state->s[b]);
+        return 0;
+    }
+
+    std::int64_t strAppendLiteral(JitState *state, int a, int b, int) {
+        state->s[a].append((*state->literals)[b]);
+        return 0;
+    }
+
+    std::int64_t strAppendInt(JitState *state, int a, int b, int) {
+        char buffer[12];
+        state->s[a].append(buffer, std::to_chars(buffer, buffer + sizeof(buffer), static_cast<int>(state->r[b])).ptr - buffer);
+        return 0;
+    }
+
+    std::int64_t strAppendBool(JitState *state, int a, int b, int) {
+        state->s[a].push_back(state->r[b] ? '1' : '0');
+        return 0;
+    }
+
+    std::int64_t strAppendCstr(JitState *state, int a, int b, int) {
+        state->s[a].append(reinterpret_cast<const char *>(state->r[b]));
+        return 0;
+    }
+
+    std::int64_t strSwap(JitState *state, int a, int b, int) {
+        state->s[a].swap(state->s[b]);
+        return 0;
+    }
+
+    std::int64_t strEqual(JitState *state, int, int b, int c) {
+        return text(state, b) == text(state, c);
+    }
+
+    std::int64_t strNotEqual(JitState *state, int, int b, int c) {
+        return text(state, b) != text(state, c);
+    }
+
+    std::int64_t strLess(JitState *state, int, int b, int c) {
+        return text(state, b) < text(state, c);
+    }
+
+    std::int64_t strGreater(JitState *state, int, int b, int c) {
+        return text(state, b) > text(state, c);
+    }
+
+    std::int64_t put(JitState *state, int a, int, int) {
+        state->output.append(state->s[a]);
+        state->output.push_back('\n');
+        if (state->output.size() >= (1 << 16))
+            flush(*state);
+        if (state->interactive) {
+            flush(*state);
+            state->out->flush();
+        }
+        return 0;
+    }
+
+    std::int64_t getInt16(JitState *state, int a, int, int) {
+        std::int16_t value = static_cast<std::int16_t>(state->r[a]);
+        *state->in >> value;
+        return value;
+    }
+
+    std::int64_t getBool(JitState *state, int a, int, int) {
+        bool value = state->r[a] != 0;
+        *state->in >> value;
+        return value;
+    }
+
+    std::int64_t getString(JitState *state, int a, int, int) {
+        *state->in >> state->s[a];
+        return 0;
+    }
+}
+
+bool k_13::Jit::isSupported() {
+    return K13_JIT;
+}
+
+int k_13::Jit::run(const BytecodeProgram &program) {
+#if K13_JIT
+    translate(program);
+    std::size_t size = (code.size() + 4095) & ~static_cast<std::size_t>(4095);
+    void *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        std::cerr << "[ERROR] Can't allocate memory for generated code" << std::endl;
+        return -1;
+    }
+    std::copy(code.begin(), code.end(), static_cast<std::uint8_t *>(memory));
+    // never writable and executable at the same time
+    if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory, size);
+        std::cerr << "[ERROR] Can't make generated code executable" << std::endl;
+        return -1;
+    }
+
+    std::vector<std::int64_t> r(program.intRegisters);
+    JitState state;
+    state.r = r.data();
+    state.s.resize(program.stringRegisters);
+    state.literals = &program.literals;
+    state.in = &in;
+    state.out = &out;
+    state.interactive = program.interactive;
+    auto entry = reinterpret_cast<std::int64_t (*)(std::int64_t *, JitState *)>(memory);
+    std::int64_t failed = entry(r.data(), &state);
+    munmap(memory, size);
+
+    int status = 0;
+    if (failed >= 0) {
+        std::cerr << "[ERROR] Division by zero at line " << program.lines[failed] << std::endl;
+        status = -1;
+    }
+    flush(state);
+    out.flush();
+    return status;
+#else
+    (void)program;
+    std::cerr << "[ERROR] The JIT needs x86-64 Linux" << std::endl;
+    return -1;
+#endif
+}
+
+// rbx holds the int registers and r12 the state for the whole run. The
+// result is -1, or the instruction that divided by zero.
+void k_13::Jit::translate(const BytecodeProgram &program) {
+    code.clear();
+    literals = &program.literals;
+    offsets.assign(program.code.size(), 0);
+    pendingJumps.clear();
+    exits.clear();
+
+    bytes({0x53});                  // push rbx
+    bytes({0x41, 0x54});            // push r12
+    bytes({0x53});                  // push rbx, keeps rsp 16 byte aligned
+    bytes({0x48, 0x89, 0xFB});      // mov rbx, rdi
+    bytes({0x49, 0x89, 0xF4});      // mov r12, rsi
+    for (std::size_t i = 0; i < program.code.size(); i++) {
+        offsets[i] = code.size();
+        instruction(program.code[i], static_cast<int>(i));
+    }
+    std::size_t exit = code.size();
+    bytes({0x59});                  // pop rcx
+    bytes({0x41, 0x5C});            // pop r12
+    bytes({0x5B});                  // pop rbx
+    bytes({0xC3});                  // ret
+
+    auto patch = [this](std::size_t field, std::size_t target) {
+        std::int32_t rel = static_cast<std::int32_t>(target - (field + 4));
+        for (int i = 0; i < 4; i++)
+            code[field + i] = static_cast<std::uint8_t>(rel >> (8 * i));
+    };
+    for (auto &pending : pendingJumps)
+        patch(pending.first, offsets[pending.second]);
+    for (auto field : exits)
+        patch(field, exit);
+}
+
+void k_13::Jit::instruction(const Instruction &instruction, int index) {
+    switch (instruction.op) {
+    case Opcode::HALT:
+        bytes({0x48, 0xC7, 0xC0});  // mov rax, -1
+        int32(-1);
+        bytes({0xE9});              // jmp exit
+        exits.push_back(code.size());
+        int32(0);
+        break;
+    case Opcode::LOAD_INT:
+        memory({0x48, 0xC7, 0x83}, instruction.a);      // mov qword [a], imm32
+        int32(instruction.b);
+        break;
+    case Opcode::LOAD_LITERAL:
+        bytes({0x48, 0xB8});                            // mov rax, address of the literal
+        int64(reinterpret_cast<std::int64_t>((*literals)[instruction.b].c_str()));
+        memory({0x48, 0x89, 0x83}, instruction.a);      // mov [a], rax
+        break;
+    case Opcode::MOVE:
+        memory({0x48, 0x8B, 0x83}, instruction.b);      // mov rax, [b]
+        memory({0x48, 0x89, 0x83}, instruction.a);      // mov [a], rax
+        break;
+    case Opcode::ADD:
+    case Opcode::SUB:
+    case Opcode::MUL:
+        memory({0x8B, 0x83}, instruction.b);            // mov eax, [b]
+        if (instruction.op == Opcode::ADD)
+            memory({0x03, 0x83}, instruction.c);        // add eax, [c]
+        else if (instruction.op == Opcode::SUB)
+            memory({0x2B, 0x83}, instruction.c);        // sub eax, [c]
+        else
+            memory({0x0F, 0xAF, 0x83}, instruction.c);  // imul eax, [c]
+        bytes({0x48, 0x63, 0xC0});                      // movsxd rax, eax
+        memory({0x48, 0x89, 0x83}, instruction.a);      // mov [a], rax
+        break;
+    case Opcode::DIV:
+    case Opcode::MOD:
+        memory({0x48, 0x8B, 0x8B}, instruction.c);      // mov rcx, [c]
+        bytes({0x48, 0x85, 0xC9});                      // test rcx, rcx
+        bytes({0x75, 0x0A});                            // jnz +10
+        bytes({0xB8});                                  // mov eax, index
+        int32(index);
+        bytes({0xE9});                                  // jmp exit
+        exits.push_back(code.size());
+        int32(0);
+        // 64 bit division, so INT_MIN / -1 wraps instead of trapping
+        memory({0x48, 0x8B, 0x83}, instruction.b);      // mov rax, [b]
+        bytes({0x48, 0x99});                            // cqo
+        bytes({0x48, 0xF7, 0xF9});                      // idiv rcx
+        if (instruction.op == Opcode::MOD)
+            bytes({0x48, 0x89, 0xD0});                  // mov rax, rdx
+        bytes({0x48, 0x63, 0xC0});                      // movsxd rax, eax
+        memory({0x48, 0x89, 0x83}, instruction.a);      // mov [a], rax
+        break;
+    case Opcode::EQUAL:
+    case Opcode::NEQUAL:
+    case Opcode::LESS:
+    case Opcode::GREATER: {
+        std::uint8_t set = instruction.op == Opcode::EQUAL ? 0x94 : instruction.op == Opcode::NEQUAL ? 0x95
+                           : instruction.op == Opcode::LESS ? 0x9C : 0x9F;
+        memory({0x48, 0x8B, 0x83}, instruction.b);      // mov rax, [b]
+        memory({0x48, 0x3B, 0x83}, instruction.c);      // cmp rax, [c]
+        bytes({0x0F, set, 0xC0});                       // setcc al
+        bytes({0x0F, 0xB6, 0xC0});                      // movzx eax, al
+        memory({0x48, 0x89, 0x83}, instruction.a);      // mov [a], rax
+        break;
+    }
+    case Opcode::STR_EQUAL:
+        call(reinterpret_cast<const void *>(&strEqual), instruction);
+        memory({0x48, 0x89, 0x83}, instruction.a);
+        break;
+    case Opcode::STR_NEQUAL:
+        call(reinterpret_cast<const void *>(&strNotEqual), instruction);
+        memory({0x48, 0x89, 0x83}, instruction.a);
+        break;
+    case Opcode::STR_LESS:
+        call(reinterpret_cast<const void *>(&strLess), instruction);
+        memory({0x48, 0x89, 0x83}, instruction.a);
+        break;
+    case Opcode::STR_GREATER:
+        call(reinterpret_cast<const void *>(&strGreater), instruction);
+        memory({0x48, 0x89, 0x83}, instruction.a);
+        break;
+    case Opcode::NOT:
+    case Opcode::TO_BOOL:
+        memory({0x48, 0x83, 0xBB}, instruction.b);      // cmp qword [b], 0
+        bytes({0x00});
+        bytes({0x0F, static_cast<std::uint8_t>(instruction.op == Opcode::NOT ? 0x94 : 0x95), 0xC0});
+        bytes({0x0F, 0xB6, 0xC0});                      // movzx eax, al
+        memory({0x48, 0x89, 0x83}, instruction.a);      // mov [a], rax
+        break;
+    case Opcode::TO_INT16:
+        memory({0x48, 0x0F, 0xBF, 0x83}, instruction.b); // movsx rax, word [b]
+        memory({0x48, 0x89, 0x83}, instruction.a);      // mov [a], rax
+        break;
+    case Opcode::JUMP:
+        jump({0xE9}, instruction.a);
+        break;
+    case Opcode::JUMP_ZERO:
+    case Opcode::JUMP_NOT_ZERO:
+        memory({0x48, 0x83, 0xBB}, instruction.a);      // cmp qword [a], 0
+        bytes({0x00});
+        jump({0x0F, static_cast<std::uint8_t>(instruction.op == Opcode::JUMP_ZERO ? 0x84 : 0x85)}, instruction.b);
+        break;
+    case Opcode::JUMP_NOT_LESS:
+        memory({0x48, 0x8B, 0x83}, instruction.a);      // mov rax, [a]
+        memory({0x48, 0x3B, 0x83}, instruction.b);      // cmp rax, [b]
+        jump({0x0F, 0x8D}, instruction.c);              // jge
+        break;
+    case Opcode::INCREMENT16:
+        memory({0x48, 0x8B, 0x83}, instruction.a);      // mov rax, [a]
+        bytes({0xFF, 0xC0});                            // inc eax
+        bytes({0x48, 0x0F, 0xBF, 0xC0});                // movsx rax, ax
+        memory({0x48, 0x89, 0x83}, instruction.a);      // mov [a], rax
+        break;
+    case Opcode::STR_CLEAR:
+        call(reinterpret_cast<const void *>(&strClear), instruction);
+        break;
+    case Opcode::STR_APPEND:
+        call(reinterpret_cast<const void *>(&strAppend), instruction);
+        break;
+    case Opcode::STR_APPEND_LITERAL:
+        call(reinterpret_cast<const void *>(&strAppendLiteral), instruction);
+        break;
+    case Opcode::STR_APPEND_INT:
+        call(reinterpret_cast<const void *>(&strAppendInt), instruction);
+        break;
+    case Opcode::STR_APPEND_BOOL:
+        call(reinterpret_cast<const void *>(&strAppendBool), instruction);
+        break;
+    case Opcode::STR_APPEND_CSTR:
+        call(reinterpret_cast<const void *>(&strAppendCstr), instruction);
+        break;
+    case Opcode::STR_SWAP:
+        call(reinterpret_cast<const void *>(&strSwap), instruction);
+        break;
+    case Opcode::PUT:
+        call(reinterpret_cast<const void *>(&put), instruction);
+        break;
+    case Opcode::GET_INT16:
+        call(reinterpret_cast<const void *>(&getInt16), instruction);
+        memory({0x48, 0x89, 0x83}, instruction.a);
+        break;
+    case Opcode::GET_BOOL:
+        call(reinterpret_cast<const void *>(&getBool), instruction);
+        memory({0x48, 0x89, 0x83}, instruction.a);
+        break;
+    case Opcode::GET_STRING:
+        call(reinterpret_cast<const void *>(&getString), instruction);
+        break;
+    default:
+        break;
+    }
+}
+
+// helper(state, a, b, c), the result comes back in rax
+void k_13::Jit::call(const void *helper, const Instruction &instruction) {
+    bytes({0x4C, 0x89, 0xE7});      // mov rdi, r12
+    bytes({0xBE});                  // mov esi, a
+    int32(instruction.a);
+    bytes({0xBA});                  // mov edx, b
+    int32(instruction.b);
+    bytes({0xB9});                  // mov ecx, c
+    int32(instruction.c);
+    bytes({0x48, 0xB8});            // mov rax, helper
+    int64(reinterpret_cast<std::int64_t>(helper));
+    bytes({0xFF, 0xD0});            // call rax
+}
+
+void k_13::Jit::jump(std::initializer_list<std::uint8_t> opcode, int target) {
+    bytes(opcode);
+    pendingJumps.emplace_back(code.size(), target);
+    int32(0);
+}
+
+void k_13::Jit::bytes(std::initializer_list<std::uint8_t> values) {
+    code.insert(code.end(), values);
+}
+
+void k_13::Jit::int32(std::int32_t value) {
+    for (int i = 0; i < 4; i++)
+        code.push_back(static_cast<std::uint8_t>(static_cast<std::uint32_t>(value) >> (8 * i)));
+}
+
+void k_13::Jit::int64(std::int64_t value) {
+    for (int i = 0; i < 8; i++)
+        code.push_back(static_cast<std::uint8_t>(static_cast<std::uint64_t>(value) >> (8 * i)));
+}
+
+void k_13::Jit::memory(std::initializer_list<std::uint8_t> opcode, int reg) {
+    bytes(opcode);
+    int32(reg * 8);
+}
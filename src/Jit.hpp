@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <iostream>
+#include <initializer_list>
+
+#include "Bytecode.hpp"
+
+namespace k_13 {
+// Translates a BytecodeProgram to x86-64 machine code in executable memory
+// and runs it in-process. Every instruction becomes a fixed template working
+// on the int register file, strings and I/O call back into small helpers.
+class Jit {
+public:
+    Jit(std::istream &in_, std::ostream &out_) : in(in_), out(out_) {}
+    ~Jit() = default;
+
+    // false when this platform can't run generated code
+    static bool isSupported();
+    // 0 when the program reaches its end, -1 on a runtime error
+    int run(const BytecodeProgram &program);
+
+private:
+    void translate(const BytecodeProgram &program);
+    void instruction(const Instruction &instruction, int index);
+    void call(const void *helper, const Instruction &instruction);
+    void jump(std::initializer_list<std::uint8_t> opcode, int target);
+
+    void bytes(std::initializer_list<std::uint8_t> values);
+    void int32(std::int32_t value);
+    void int64(std::int64_t value);
+    // instruction with a [rbx + 8 * reg] operand
+    void memory(std::initializer_list<std::uint8_t> opcode, int reg);
+
+    std::istream &in;
+    std::ostream &out;
+    const std::vector<std::string> *literals = nullptr;
+    std::vector<std::uint8_t> code;
+    // machine code offset of every bytecode instruction
+    std::vector<std::size_t> offsets;
+    // rel32 fields waiting for the offset of their target instruction
+    std::vector<std::pair<std::size_t, int>> pendingJumps;
+    // rel32 fields of the jumps that leave the program
+    std::vector<std::size_t> exits;
+};
+
+} // k_13
@@ -36,6 +36,7 @@ namespace k_13 {
             lexems.clear();
         if(!literals.empty())
             literals.clear();
+        literalIds.clear();
         if(!unknownLexems.empty())
             unknownLexems.clear();
 
@@ -247,8 +248,14 @@ namespace k_13 {
             
         } catch (const std::exception& e) {
             if(token[0] == '"' && token[token.length() - 1] == '"') {
+                auto interned = literalIds.find(token);
+                if(interned != literalIds.end()) {
+                    lexems.push_back({LexemType::STRING_LITERAL, std::to_string(interned->second), tokenLine});
+                    return;
+                }
                 lexems.push_back({LexemType::STRING_LITERAL, std::to_string(literalId), tokenLine});
                 literals.push_back({literalId, token});
+                literalIds[token] = literalId;
                 literalId++;
                 return;
             } else if(token[0] >= 'a' && token[0] <= 'z' && token.length() <= 6) {
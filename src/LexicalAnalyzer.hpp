@@ -8,6 +8,7 @@
 #include <mutex>
 #include <thread>
 #include <vector>
+#include <map>
 
 #include "constants.hpp"
 
@@ -28,6 +29,8 @@ namespace k_13
 
         std::vector<Lexem> lexems;
         std::vector<Literal> literals;
+        // id of each literal text, equal literals share one entry
+        std::map<std::string, int> literalIds;
         std::vector<UnknownLexem> unknownLexems;
 
         void checkLexem(int tokenLine, std::string token);
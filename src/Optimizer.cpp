@@ -0,0 +1,994 @@
+#include "Optimizer.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+void k_13::Optimizer::eliminateDeadCode(std::vector<Keyword> &keywords) {
+    removedStatements = 0;
+    removedDeclarations = 0;
+    // usage tables are only refreshed once per round, so they may still count
+    // statements removed in this round. That keeps every step conservative.
+    bool changed = true;
+    while (changed) {
+        labelReferences.clear();
+        readVariables.clear();
+        usedVariables.clear();
+        collectUsage(keywords);
+        usedVariables.insert(readVariables.begin(), readVariables.end());
+        changed = removeUnreachable(keywords, 0);
+        changed |= removeUnusedLabels(keywords, 0);
+        changed |= removeDeadStores(keywords);
+        changed |= removeUnusedVariables(keywords);
+    }
+}
+
+void k_13::Optimizer::collectUsage(const std::vector<Keyword> &keywords) {
+    for (auto &keyword : keywords) {
+        switch (keyword.keyword) {
+        case LexemType::START:
+            collectUsage(keyword.keywords);
+            break;
+        case LexemType::ASSIGN:
+            usedVariables.insert(keyword.label);
+            collectReads(keyword.expression1, readVariables);
+            break;
+        case LexemType::GET:
+            usedVariables.insert(keyword.label);
+            break;
+        case LexemType::PUT:
+            collectReads(keyword.expression1, readVariables);
+            break;
+        case LexemType::GOTO:
+            labelReferences[keyword.label]++;
+            break;
+        case LexemType::IF:
+            collectReads(keyword.expression1, readVariables);
+            labelReferences[keyword.label]++;
+            if (!keyword.label2.empty())
+                labelReferences[keyword.label2]++;
+            if (!keyword.comp.empty())
+                collectUsage(keyword.comp.front().keywords);
+            break;
+        case LexemType::FOR:
+            // loop condition and increment read the counter
+            readVariables.insert(keyword.label);
+            collectReads(keyword.expression1, readVariables);
+            collectReads(keyword.expression2, readVariables);
+            collectUsage(keyword.keywords);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void k_13::Optimizer::collectReads(const std::vector<Lexem> &expression, std::set<std::string> &reads) {
+    for (auto &lexem : expression) {
+        if (lexem.type == LexemType::IDENTIFIER)
+            reads.insert(lexem.value);
+    }
+}
+
+// statements are only marked while a pass scans them and removed at its end,
+// so a pass moves each statement once however many it removes
+void k_13::Optimizer::compact(std::vector<Keyword> &keywords, const std::vector<bool> &removed) {
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < keywords.size(); i++) {
+        if (removed[i])
+            continue;
+        if (kept != i)
+            keywords[kept] = std::move(keywords[i]);
+        kept++;
+    }
+    keywords.erase(keywords.begin() + static_cast<std::ptrdiff_t>(kept), keywords.end());
+}
+
+bool k_13::Optimizer::removeUnreachable(std::vector<Keyword> &keywords, int depth) {
+    bool changed = false, reachable = true;
+    std::vector<bool> removed(keywords.size());
+    for (auto it = keywords.begin(); it != keywords.end(); ++it) {
+        if (!reachable) {
+            if (definesUsedLabel(*it)) {
+                reachable = true;
+            } else {
+                removed[it - keywords.begin()] = true;
+                removedStatements++;
+                changed = true;
+                continue;
+            }
+        }
+        switch (it->keyword) {
+        case LexemType::START:
+        case LexemType::FOR:
+            changed |= removeUnreachable(it->keywords, depth + 1);
+            break;
+        case LexemType::IF:
+            if (!it->comp.empty())
+                changed |= removeUnreachable(it->comp.front().keywords, depth + 1);
+            break;
+        default:
+            break;
+        }
+        if (terminates(*it))
+            reachable = false;
+    }
+    if (changed)
+        compact(keywords, removed);
+    return changed;
+}
+
+bool k_13::Optimizer::removeUnusedLabels(std::vector<Keyword> &keywords, int depth) {
+    bool changed = false, placeholders = false;
+    std::vector<bool> removed(keywords.size());
+    for (auto it = keywords.begin(); it != keywords.end(); ++it) {
+        switch (it->keyword) {
+        case LexemType::PROGRAM:
+            // placeholder left by the parser for an empty statement list
+            removed[it - keywords.begin()] = true;
+            placeholders = true;
+            continue;
+        case LexemType::LABEL:
+            if (labelReferences[it->label] == 0) {
+                removed[it - keywords.begin()] = true;
+                removedStatements++;
+                changed = true;
+                continue;
+            }
+            break;
+        case LexemType::GOTO:
+            if (std::next(it) != keywords.end() && std::next(it)->keyword == LexemType::LABEL && std::next(it)->label == it->label) {
+                removed[it - keywords.begin()] = true;
+                removedStatements++;
+                changed = true;
+                continue;
+            }
+            break;
+        case LexemType::IF:
+            if (!it->comp.empty()) {
+                changed |= removeUnusedLabels(it->comp.front().keywords, depth + 1);
+                if (isEmptyBlock(it->comp.front())) {
+                    it->comp.clear();
+                    removedStatements++;
+                    changed = true;
+                }
+            }
+            if (!it->label3.empty() && labelReferences[it->label3] == 0) {
+                it->label3.clear();
+                removedStatements++;
+                changed = true;
+            }
+            if (!it->label2.empty() && (it->label2 == it->label3 || (it->label3.empty() && std::next(it) != keywords.end()
+                && std::next(it)->keyword == LexemType::LABEL && std::next(it)->label == it->label2))) {
+                it->label2.clear();
+                removedStatements++;
+                changed = true;
+            }
+            break;
+        case LexemType::START:
+            changed |= removeUnusedLabels(it->keywords, depth + 1);
+            // the outermost block is the body of main and has to stay
+            if (depth > 0 && isEmptyBlock(*it)) {
+                removed[it - keywords.begin()] = true;
+                removedStatements++;
+                changed = true;
+                continue;
+            }
+            break;
+        case LexemType::FOR:
+            changed |= removeUnusedLabels(it->keywords, depth + 1);
+            break;
+        default:
+            break;
+        }
+    }
+    if (changed || placeholders)
+        compact(keywords, removed);
+    return changed;
+}
+
+bool k_13::Optimizer::removeDeadStores(std::vector<Keyword> &keywords) {
+    bool changed = false;
+    for (auto &keyword : keywords) {
+        switch (keyword.keyword) {
+        case LexemType::START:
+        case LexemType::FOR:
+            changed |= removeDeadStores(keyword.keywords);
+            break;
+        case LexemType::IF:
+            if (!keyword.comp.empty())
+                changed |= removeDeadStores(keyword.comp.front().keywords);
+            break;
+        default:
+            break;
+        }
+    }
+
+    // walk the straight-line code backwards. A store is dead when the variable
+    // is overwritten later with no read in between. Any control flow statement
+    // resets the knowledge, so everything is live across jumps, loops and blocks.
+    std::set<std::string> overwritten;
+    std::vector<bool> removed(keywords.size());
+    bool removedHere = false;
+    for (int i = static_cast<int>(keywords.size()) - 1; i >= 0; i--) {
+        Keyword &keyword = keywords[i];
+        std::set<std::string> reads;
+        switch (keyword.keyword) {
+        case LexemType::ASSIGN:
+            if (!readVariables.contains(keyword.label) || overwritten.contains(keyword.label)) {
+                removed[i] = true;
+                removedHere = true;
+                removedStatements++;
+                changed = true;
+                break;
+            }
+            overwritten.insert(keyword.label);
+            collectReads(keyword.expression1, reads);
+            for (auto &read : reads)
+                overwritten.erase(read);
+            break;
+        case LexemType::GET:
+            // on a failed read the variable keeps its value, so get reads it too
+            overwritten.erase(keyword.label);
+            break;
+        case LexemType::PUT:
+            collectReads(keyword.expression1, reads);
+            for (auto &read : reads)
+                overwritten.erase(read);
+            break;
+        default:
+            overwritten.clear();
+            break;
+        }
+    }
+    if (removedHere)
+        compact(keywords, removed);
+    return changed;
+}
+
+bool k_13::Optimizer::removeUnusedVariables(std::vector<Keyword> &keywords) {
+    bool changed = false;
+    for (auto &keyword : keywords) {
+        switch (keyword.keyword) {
+        case LexemType::START:
+        case LexemType::FOR:
+            for (auto it = keyword.variables.begin(); it != keyword.variables.end();) {
+                if (!usedVariables.contains(it->first)) {
+                    it = keyword.variables.erase(it);
+                    removedDeclarations++;
+                    changed = true;
+                } else {
+                    ++it;
+                }
+            }
+            changed |= removeUnusedVariables(keyword.keywords);
+            break;
+        case LexemType::IF:
+            if (!keyword.comp.empty())
+                changed |= removeUnusedVariables(keyword.comp);
+            break;
+        default:
+            break;
+        }
+    }
+    return changed;
+}
+
+bool k_13::Optimizer::terminates(const Keyword &keyword) {
+    switch (keyword.keyword) {
+    case LexemType::GOTO:
+        return true;
+    case LexemType::START:
+        return !keyword.keywords.empty() && terminates(keyword.keywords.back());
+    default:
+        return false;
+    }
+}
+
+bool k_13::Optimizer::definesUsedLabel(const Keyword &keyword) {
+    switch (keyword.keyword) {
+    case LexemType::LABEL:
+        return labelReferences[keyword.label] > 0;
+    case LexemType::IF:
+        if (!keyword.label3.empty() && labelReferences[keyword.label3] > 0)
+            return true;
+        return !keyword.comp.empty() && definesUsedLabel(keyword.comp.front());
+    case LexemType::START:
+    case LexemType::FOR:
+        for (auto &statement : keyword.keywords) {
+            if (definesUsedLabel(statement))
+                return true;
+        }
+        return false;
+    default:
+        return false;
+    }
+}
+
+bool k_13::Optimizer::isEmptyBlock(const Keyword &keyword) {
+    if (!keyword.variables.empty())
+        return false;
+    for (auto &statement : keyword.keywords) {
+        if (statement.keyword != LexemType::PROGRAM)
+            return false;
+    }
+    return true;
+}
+
+void k_13::Optimizer::eliminateCommonSubexpressions(std::vector<Keyword> &keywords) {
+    temporaries = 0;
+    replacedExpressions = 0;
+    available.clear();
+    recorded.clear();
+    pendingTemporaries.clear();
+    cseBlock(keywords, nullptr, {}, 0);
+}
+
+void k_13::Optimizer::cseBlock(std::vector<Keyword> &keywords, std::map<std::string, LexemType> *declarations
+                               , std::map<std::string, LexemType> scope, int depth) {
+    // trees must outlive every first occurrence that points into them, so they
+    // are kept until the whole block is done and only then written back
+    std::list<ParsedExpression> parsed;
+    std::set<std::string> assigned;
+    for (int i = 0; i < static_cast<int>(keywords.size()); i++) {
+        Keyword &keyword = keywords[i];
+        Site site{&keywords, i, declarations, &scope, depth, nullptr};
+        assigned.clear();
+        switch (keyword.keyword) {
+        case LexemType::ASSIGN: {
+            bool isString = scope.contains(keyword.label) && scope[keyword.label] == LexemType::STRING;
+            cseExpression(cseParse(parsed, keyword.expression1, isString), site);
+            cseKill({keyword.label});
+            break;
+        }
+        case LexemType::GET:
+            cseKill({keyword.label});
+            break;
+        case LexemType::PUT:
+            cseExpression(cseParse(parsed, keyword.expression1, true), site);
+            break;
+        case LexemType::IF:
+            cseExpression(cseParse(parsed, keyword.expression1, false), site);
+            if (!keyword.comp.empty()) {
+                std::map<std::string, LexemType> inner = scope;
+                inner.insert(keyword.comp.front().variables.begin(), keyword.comp.front().variables.end());
+                cseBlock(keyword.comp.front().keywords, &keyword.comp.front().variables, inner, depth + 1);
+                assignedVariables(keyword.comp.front().keywords, assigned);
+                cseKill(assigned);
+            }
+            // the label after the block joins the jump of the condition
+            if (!keyword.label3.empty()) {
+                available.clear();
+                recorded.clear();
+            }
+            break;
+        case LexemType::FOR: {
+            cseExpression(cseParse(parsed, keyword.expression1, false), site);
+            assignedVariables(keyword.keywords, assigned);
+            assigned.insert(keyword.label);
+            cseKill(assigned);
+            // the bound is evaluated on every iteration, it may only take part
+            // when nothing in the loop changes it
+            ParsedExpression &bound = cseParse(parsed, keyword.expression2, false);
+            std::vector<std::string> identifiers;
+            ExpressionTree::collectIdentifiers(bound.tree, identifiers);
+            bool invariant = true;
+            for (auto &identifier : identifiers) {
+                std::set<std::string> dependencies = temporaryDependencies.contains(identifier)
+                    ? temporaryDependencies[identifier] : std::set<std::string>{identifier};
+                for (auto &dependency : dependencies)
+                    invariant &= !assigned.contains(dependency);
+            }
+            if (invariant)
+                cseExpression(bound, site);
+            std::map<std::string, LexemType> inner = scope;
+            inner[keyword.label] = LexemType::INT;
+            cseBlock(keyword.keywords, &keyword.variables, inner, depth + 1);
+            cseKill(assigned);
+            break;
+        }
+        case LexemType::START: {
+            std::map<std::string, LexemType> inner = scope;
+            inner.insert(keyword.variables.begin(), keyword.variables.end());
+            cseBlock(keyword.keywords, &keyword.variables, inner, depth + 1);
+            assignedVariables(keyword.keywords, assigned);
+            cseKill(assigned);
+            break;
+        }
+        case LexemType::LABEL:
+        case LexemType::GOTO:
+            available.clear();
+            recorded.clear();
+            break;
+        default:
+            break;
+        }
+    }
+
+    cseLeave(depth);
+    for (auto &expression : parsed) {
+        if (!expression.changed)
+            continue;
+        *expression.target = expression.isString ? ExpressionTree::flattenString(expression.factors)
+                                                 : ExpressionTree::flatten(expression.tree);
+    }
+    insertTemporaries(keywords);
+}
+
+k_13::Optimizer::ParsedExpression &k_13::Optimizer::cseParse(std::list<ParsedExpression> &parsed, std::vector<Lexem> &expression, bool isString) {
+    ExpressionTree tree;
+    ParsedExpression &result = parsed.emplace_back();
+    result.target = &expression;
+    result.isString = isString;
+    if (isString)
+        result.factors = tree.parseString(expression);
+    else
+        result.tree = tree.parse(expression);
+    return result;
+}
+
+void k_13::Optimizer::cseExpression(ParsedExpression &parsed, Site site) {
+    site.parsed = &parsed;
+    std::set<std::string> dependencies;
+    if (parsed.isString) {
+        for (auto &factor : parsed.factors)
+            cseNode(factor, site, false, dependencies);
+    } else if (!parsed.target->empty()) {
+        cseNode(parsed.tree, site, false, dependencies);
+    }
+}
+
+// value numbering bottom-up: the key of a node is built from the keys of its
+// operands, so a temporary standing for a value keeps the key of that value
+std::string k_13::Optimizer::cseNode(ExpressionNode &node, Site &site, bool conditional, std::set<std::string> &dependencies) {
+    if (ExpressionTree::isLeaf(node)) {
+        switch (node.lexem.type) {
+        case LexemType::NUMBER:
+            return "n" + std::to_string(node.lexem.constant);
+        case LexemType::TRUE:
+            return "t";
+        case LexemType::FALSE:
+            return "f";
+        case LexemType::IDENTIFIER:
+            if (temporaryKeys.contains(node.lexem.value)) {
+                dependencies.insert(temporaryDependencies[node.lexem.value].begin(), temporaryDependencies[node.lexem.value].end());
+                return temporaryKeys[node.lexem.value];
+            }
+            // a temporary is int or bool, it can't hold a concatenation
+            if (site.scope->contains(node.lexem.value) && site.scope->at(node.lexem.value) == LexemType::STRING)
+                return "";
+            dependencies.insert(node.lexem.value);
+            return "v" + node.lexem.value;
+        default:
+            // string literals compare by address in C++, never share them
+            return "";
+        }
+    }
+
+    LexemType op = node.lexem.type;
+    bool shortCircuit = op == LexemType::AND || op == LexemType::OR;
+    std::vector<std::string> keys;
+    std::set<std::string> nodeDependencies;
+    bool pure = true;
+    for (size_t i = 0; i < node.operands.size(); i++) {
+        keys.push_back(cseNode(node.operands[i], site, conditional || (shortCircuit && i > 0), nodeDependencies));
+        pure &= !keys.back().empty();
+    }
+    dependencies.insert(nodeDependencies.begin(), nodeDependencies.end());
+    if (!pure)
+        return "";
+    if (op == LexemType::ADD || op == LexemType::MUL || op == LexemType::EQUAL || op == LexemType::NEQUAL)
+        std::sort(keys.begin(), keys.end());
+    std::string key = "(" + std::to_string(static_cast<int>(op));
+    for (auto &operand : keys)
+        key += " " + operand;
+    key += ")";
+    // constant subtrees are folded by the C++ compiler anyway
+    if (nodeDependencies.empty())
+        return key;
+
+    auto found = available.find(key);
+    if (found == available.end()) {
+        // a value computed only on one side of && or || is moved in front of
+        // the statement, which must not introduce a division by zero
+        if (site.declarations != nullptr && !(conditional && ExpressionTree::canTrap(node))) {
+            available[key] = {"", &node, site, nodeDependencies};
+            recorded[&node] = key;
+        }
+        return key;
+    }
+
+    AvailableExpression &entry = found->second;
+    if (entry.temporary.empty()) {
+        entry.temporary = "_cse" + std::to_string(++temporaries);
+        Keyword definition;
+        definition.keyword = LexemType::ASSIGN;
+        definition.label = entry.temporary;
+        ExpressionNode value = *entry.node;
+        value.parentheses = 0;
+        definition.expression1 = ExpressionTree::flatten(value);
+        (*entry.site.declarations)[entry.temporary] = ExpressionTree::isLogical(value) ? LexemType::BOOL : LexemType::NUMBER;
+        pendingTemporaries[entry.site.keywords].emplace_back(entry.site.index, definition);
+        temporaryKeys[entry.temporary] = key;
+        temporaryDependencies[entry.temporary] = nodeDependencies;
+        ExpressionNode *first = entry.node;
+        recorded.erase(first);
+        entry.node = nullptr;
+        cseReplace(*first, entry.temporary);
+        entry.site.parsed->changed = true;
+        replacedExpressions++;
+    }
+    std::string temporary = entry.temporary;
+    cseReplace(node, temporary);
+    site.parsed->changed = true;
+    replacedExpressions++;
+    return key;
+}
+
+void k_13::Optimizer::cseReplace(ExpressionNode &node, const std::string &temporary) {
+    cseForget(node);
+    Lexem lexem{LexemType::IDENTIFIER, temporary, node.lexem.line};
+    node.operands.clear();
+    node.parentheses = 0;
+    node.lexem = lexem;
+}
+
+void k_13::Optimizer::cseForget(ExpressionNode &node) {
+    auto found = recorded.find(&node);
+    if (found != recorded.end()) {
+        auto entry = available.find(found->second);
+        if (entry != available.end() && entry->second.node == &node)
+            available.erase(entry);
+        recorded.erase(found);
+    }
+    for (auto &operand : node.operands)
+        cseForget(operand);
+}
+
+void k_13::Optimizer::cseKill(const std::set<std::string> &variables) {
+    for (auto it = available.begin(); it != available.end();) {
+        bool killed = false;
+        for (auto &variable : variables)
+            killed |= it->second.dependencies.contains(variable);
+        if (killed) {
+            if (it->second.node != nullptr)
+                recorded.erase(it->second.node);
+            it = available.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void k_13::Optimizer::cseLeave(int depth) {
+    for (auto it = available.begin(); it != available.end();) {
+        if (it->second.site.depth >= depth) {
+            if (it->second.node != nullptr)
+                recorded.erase(it->second.node);
+            it = available.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void k_13::Optimizer::insertTemporaries(std::vector<Keyword> &keywords) {
+    auto pending = pendingTemporaries.find(&keywords);
+    if (pending == pendingTemporaries.end())
+        return;
+    // definitions go in front of the statement that computed the value first,
+    // in creation order, so smaller temporaries precede the ones using them
+    std::vector<Keyword> result;
+    result.reserve(keywords.size() + pending->second.size());
+    std::stable_sort(pending->second.begin(), pending->second.end(),
+                     [](const auto &a, const auto &b) { return a.first < b.first; });
+    auto definition = pending->second.begin();
+    for (int i = 0; i < static_cast<int>(keywords.size()); i++) {
+        while (definition != pending->second.end() && definition->first == i) {
+            result.push_back(std::move(definition->second));
+            ++definition;
+        }
+        result.push_back(std::move(keywords[i]));
+    }
+    keywords = std::move(result);
+    pendingTemporaries.erase(pending);
+}
+
+void k_13::Optimizer::assignedVariables(const std::vector<Keyword> &keywords, std::set<std::string> &assigned) {
+    for (auto &keyword : keywords) {
+        switch (keyword.keyword) {
+        case LexemType::ASSIGN:
+        case LexemType::GET:
+            assigned.insert(keyword.label);
+            break;
+        case LexemType::FOR:
+            assigned.insert(keyword.label);
+            assignedVariables(keyword.keywords, assigned);
+            break;
+        case LexemType::START:
+            assignedVariables(keyword.keywords, assigned);
+            break;
+        case LexemType::IF:
+            if (!keyword.comp.empty())
+                assignedVariables(keyword.comp.front().keywords, assigned);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void k_13::Optimizer::hoistLoopInvariants(std::vector<Keyword> &keywords) {
+    hoistedExpressions = 0;
+    loopTemporaries = 0;
+    pendingTemporaries.clear();
+    std::set<std::string> definitions;
+    labelReferences.clear();
+    labelUsage(keywords, labelReferences, definitions);
+    licmBlock(keywords, nullptr, {});
+}
+
+void k_13::Optimizer::licmBlock(std::vector<Keyword> &keywords, std::map<std::string, LexemType> *declarations
+                                , std::map<std::string, LexemType> scope) {
+    for (int i = 0; i < static_cast<int>(keywords.size()); i++) {
+        Keyword &keyword = keywords[i];
+        std::map<std::string, LexemType> inner = scope;
+        switch (keyword.keyword) {
+        case LexemType::START:
+            inner.insert(keyword.variables.begin(), keyword.variables.end());
+            licmBlock(keyword.keywords, &keyword.variables, inner);
+            break;
+        case LexemType::IF:
+            if (!keyword.comp.empty()) {
+                inner.insert(keyword.comp.front().variables.begin(), keyword.comp.front().variables.end());
+                licmBlock(keyword.comp.front().keywords, &keyword.comp.front().variables, inner);
+            }
+            break;
+        case LexemType::FOR: {
+            // inner loops first, what they hoist lands in this loop's body
+            // and can move further out from here
+            inner[keyword.label] = LexemType::INT;
+            licmBlock(keyword.keywords, &keyword.variables, inner);
+            if (declarations == nullptr)
+                break;
+            Loop context;
+            context.keywords = &keywords;
+            context.index = i;
+            context.declarations = declarations;
+            licmLoop(keyword, context, inner);
+            break;
+        }
+        default:
+            break;
+        }
+    }
+    insertTemporaries(keywords);
+}
+
+void k_13::Optimizer::licmLoop(Keyword &loop, Loop &context, const std::map<std::string, LexemType> &scope) {
+    // a goto from outside into the body would skip the hoisted computations
+    std::map<std::string, int> references;
+    std::set<std::string> definitions;
+    labelUsage(loop.keywords, references, definitions);
+    for (auto &label : definitions) {
+        if (labelReferences[label] > references[label])
+            return;
+    }
+
+    assignedVariables(loop.keywords, context.variant);
+    context.variant.insert(loop.label);
+
+    // the bound is evaluated at least once, so even a division may move
+    ExpressionTree tree;
+    ExpressionNode bound = tree.parse(loop.expression2);
+    if (!loop.expression2.empty() && !ExpressionTree::isLeaf(bound) && isInvariant(bound, context, scope)
+        && !ExpressionTree::hasStringLiteral(bound)) {
+        std::string temporary = licmHoist(bound, context);
+        loop.expression2 = {{LexemType::IDENTIFIER, temporary, loop.expression2.front().line}};
+    }
+
+    // temporaries defined directly in the body move out as whole statements,
+    // which makes the expressions using them invariant in turn
+    for (auto it = loop.keywords.begin(); it != loop.keywords.end();) {
+        std::set<std::string> reads;
+        ExpressionNode value = tree.parse(it->expression1);
+        if (it->keyword == LexemType::ASSIGN && it->label.starts_with("_") && loop.variables.contains(it->label)
+            && !it->expression1.empty() && isInvariant(value, context, scope) && !ExpressionTree::canTrap(value)) {
+            (*context.declarations)[it->label] = loop.variables[it->label];
+            loop.variables.erase(it->label);
+            context.variant.erase(it->label);
+            pendingTemporaries[context.keywords].emplace_back(context.index, std::move(*it));
+            it = loop.keywords.erase(it);
+            hoistedExpressions++;
+            continue;
+        }
+        ++it;
+    }
+
+    licmStatements(loop.keywords, context, scope);
+}
+
+void k_13::Optimizer::licmStatements(std::vector<Keyword> &keywords, Loop &context, std::map<std::string, LexemType> scope) {
+    for (auto &keyword : keywords) {
+        std::map<std::string, LexemType> inner = scope;
+        switch (keyword.keyword) {
+        case LexemType::ASSIGN:
+            licmExpression(keyword.expression1, scope.contains(keyword.label) && scope[keyword.label] == LexemType::STRING, context, scope);
+            break;
+        case LexemType::PUT:
+            licmExpression(keyword.expression1, true, context, scope);
+            break;
+        case LexemType::IF:
+            licmExpression(keyword.expression1, false, context, scope);
+            if (!keyword.comp.empty()) {
+                inner.insert(keyword.comp.front().variables.begin(), keyword.comp.front().variables.end());
+                licmStatements(keyword.comp.front().keywords, context, inner);
+            }
+            break;
+        case LexemType::FOR:
+            licmExpression(keyword.expression1, false, context, scope);
+            licmExpression(keyword.expression2, false, context, scope);
+            inner[keyword.label] = LexemType::INT;
+            licmStatements(keyword.keywords, context, inner);
+            break;
+        case LexemType::START:
+            inner.insert(keyword.variables.begin(), keyword.variables.end());
+            licmStatements(keyword.keywords, context, inner);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+bool k_13::Optimizer::licmExpression(std::vector<Lexem> &expression, bool isString, Loop &context
+                                     , const std::map<std::string, LexemType> &scope) {
+    if (expression.empty())
+        return false;
+    ExpressionTree tree;
+    bool changed = false;
+    if (isString) {
+        std::vector<ExpressionNode> factors = tree.parseString(expression);
+        for (auto &factor : factors)
+            changed |= licmNode(factor, context, scope);
+        if (changed)
+            expression = ExpressionTree::flattenString(factors);
+    } else {
+        ExpressionNode node = tree.parse(expression);
+        changed = licmNode(node, context, scope);
+        if (changed)
+            expression = ExpressionTree::flatten(node);
+    }
+    return changed;
+}
+
+// hoists the largest invariant subtrees. The loop may run zero times, so
+// only expressions that cannot divide by zero are computed in front of it.
+bool k_13::Optimizer::licmNode(ExpressionNode &node, Loop &context, const std::map<std::string, LexemType> &scope) {
+    if (ExpressionTree::isLeaf(node))
+        return false;
+    std::vector<std::string> identifiers;
+    ExpressionTree::collectIdentifiers(node, identifiers);
+    if (!identifiers.empty() && isInvariant(node, context, scope) && !ExpressionTree::hasStringLiteral(node)
+        && !ExpressionTree::canTrap(node)) {
+        std::string temporary = licmHoist(node, context);
+        node = {{LexemType::IDENTIFIER, temporary, node.lexem.line}, 0, {}};
+        return true;
+    }
+    bool changed = false;
+    for (auto &operand : node.operands)
+        changed |= licmNode(operand, context, scope);
+    return changed;
+}
+
+std::string k_13::Optimizer::licmHoist(const ExpressionNode &node, Loop &context) {
+    ExpressionNode value = node;
+    value.parentheses = 0;
+    std::vector<Lexem> expression = ExpressionTree::flatten(value);
+    std::string key;
+    for (auto &lexem : expression)
+        key += lexem.value + " ";
+    if (context.hoisted.contains(key))
+        return context.hoisted[key];
+
+    Keyword definition;
+    definition.keyword = LexemType::ASSIGN;
+    definition.label = "_lic" + std::to_string(++loopTemporaries);
+    hoistedExpressions++;
+    definition.expression1 = expression;
+    (*context.declarations)[definition.label] = ExpressionTree::isLogical(value) ? LexemType::BOOL : LexemType::NUMBER;
+    context.hoisted[key] = definition.label;
+    pendingTemporaries[context.keywords].emplace_back(context.index, definition);
+    return definition.label;
+}
+
+// the temporary is int or bool, so a subtree over strings stays where it is
+bool k_13::Optimizer::isInvariant(const ExpressionNode &node, const Loop &context, const std::map<std::string, LexemType> &scope) {
+    std::vector<std::string> identifiers;
+    ExpressionTree::collectIdentifiers(node, identifiers);
+    for (auto &identifier : identifiers) {
+        if (context.variant.contains(identifier))
+            return false;
+        auto type = scope.find(identifier);
+        if (type != scope.end() && type->second == LexemType::STRING)
+            return false;
+    }
+    return true;
+}
+
+void k_13::Optimizer::labelUsage(const std::vector<Keyword> &keywords, std::map<std::string, int> &references, std::set<std::string> &definitions) {
+    for (auto &keyword : keywords) {
+        switch (keyword.keyword) {
+        case LexemType::GOTO:
+            references[keyword.label]++;
+            break;
+        case LexemType::LABEL:
+            definitions.insert(keyword.label);
+            break;
+        case LexemType::IF:
+            references[keyword.label]++;
+            if (!keyword.label2.empty())
+                references[keyword.label2]++;
+            if (!keyword.label3.empty())
+                definitions.insert(keyword.label3);
+            if (!keyword.comp.empty())
+                labelUsage(keyword.comp.front().keywords, references, definitions);
+            break;
+        case LexemType::START:
+        case LexemType::FOR:
+            labelUsage(keyword.keywords, references, definitions);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+// bounds only grow and stop at inlineStringLimit, so the iteration ends.
+// A string assigned from itself keeps growing until it passes the limit.
+void k_13::Optimizer::boundStringLengths(const std::vector<Keyword> &keywords, const std::vector<Literal> &literals) {
+    std::map<std::string, LexemType> declarations;
+    collectDeclarations(keywords, declarations);
+    stringBounds.clear();
+    stringVariables = 0;
+    for (auto &declaration : declarations) {
+        if (declaration.second == LexemType::STRING) {
+            stringBounds[declaration.first] = 0;
+            stringVariables++;
+        }
+    }
+    std::vector<const Keyword*> stores;
+    std::vector<const std::vector<Keyword>*> blocks = {&keywords};
+    while (!blocks.empty()) {
+        const std::vector<Keyword> *block = blocks.back();
+        blocks.pop_back();
+        for (auto &keyword : *block) {
+            switch (keyword.keyword) {
+            case LexemType::ASSIGN:
+            case LexemType::GET:
+                if (stringBounds.contains(keyword.label))
+                    stores.push_back(&keyword);
+                break;
+            case LexemType::START:
+            case LexemType::FOR:
+                blocks.push_back(&keyword.keywords);
+                break;
+            case LexemType::IF:
+                if (!keyword.comp.empty())
+                    blocks.push_back(&keyword.comp.front().keywords);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto store : stores) {
+            auto bound = stringBounds.find(store->label);
+            if (bound == stringBounds.end())
+                continue;
+            std::size_t length = inlineStringLimit + 1;
+            if (store->keyword == LexemType::ASSIGN)
+                length = stringLength(store->expression1, declarations, literals);
+            if (length > inlineStringLimit) {
+                stringBounds.erase(bound);
+                changed = true;
+            }
+            else if (length > bound->second) {
+                bound->second = length;
+                changed = true;
+            }
+        }
+    }
+}
+
+void k_13::Optimizer::collectDeclarations(const std::vector<Keyword> &keywords, std::map<std::string, LexemType> &declarations) {
+    for (auto &keyword : keywords) {
+        switch (keyword.keyword) {
+        case LexemType::START:
+        case LexemType::FOR:
+            declarations.insert(keyword.variables.begin(), keyword.variables.end());
+            collectDeclarations(keyword.keywords, declarations);
+            break;
+        case LexemType::IF:
+            if (!keyword.comp.empty()) {
+                declarations.insert(keyword.comp.front().variables.begin(), keyword.comp.front().variables.end());
+                collectDeclarations(keyword.comp.front().keywords, declarations);
+            }
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+std::size_t k_13::Optimizer::stringLength(const std::vector<Lexem> &expression, const std::map<std::string, LexemType> &declarations
+                                          , const std::vector<Literal> &literals) {
+    ExpressionTree parser;
+    std::size_t length = 0;
+    for (auto &factor : parser.parseString(expression)) {
+        length += factorLength(factor, declarations, literals);
+        if (length > inlineStringLimit)
+            break;
+    }
+    return length;
+}
+
+// longest text the generated code can append for one factor
+std::size_t k_13::Optimizer::factorLength(const ExpressionNode &node, const std::map<std::string, LexemType> &declarations
+                                          , const std::vector<Literal> &literals) {
+    if (!ExpressionTree::isLeaf(node)) {
+        if (ExpressionTree::isLogical(node))
+            return 1;
+        // pointer arithmetic on a literal, nothing to say about it
+        if (ExpressionTree::hasStringLiteral(node))
+            return inlineStringLimit + 1;
+        // a concatenation in parentheses, of any length
+        std::vector<std::string> identifiers;
+        ExpressionTree::collectIdentifiers(node, identifiers);
+        for (auto &identifier : identifiers) {
+            auto declaration = declarations.find(identifier);
+            if (declaration == declarations.end() || declaration->second == LexemType::STRING)
+                return inlineStringLimit + 1;
+        }
+        return std::to_string(INT32_MIN).size();
+    }
+    switch (node.lexem.type) {
+    case LexemType::STRING_LITERAL: {
+        // characters between the quotes, an escape sequence counts as one
+        const std::string &literal = literals[std::stoi(node.lexem.value)-1].value;
+        std::size_t length = 0;
+        for (std::size_t i = 1; i + 1 < literal.size(); i++) {
+            if (literal[i] == '\\')
+                i++;
+            length++;
+        }
+        return length;
+    }
+    case LexemType::NUMBER:
+        return std::to_string(node.lexem.constant).size();
+    case LexemType::TRUE:
+    case LexemType::FALSE:
+        return 1;
+    case LexemType::IDENTIFIER: {
+        auto declaration = declarations.find(node.lexem.value);
+        if (declaration == declarations.end())
+            return inlineStringLimit + 1;
+        switch (declaration->second) {
+        case LexemType::STRING: {
+            auto bound = stringBounds.find(node.lexem.value);
+            return bound != stringBounds.end() ? bound->second : inlineStringLimit + 1;
+        }
+        case LexemType::BOOL:
+            return 1;
+        case LexemType::INT:
+            return std::to_string(INT16_MIN).size();
+        default:
+            return std::to_string(INT32_MIN).size();
+        }
+    }
+    default:
+        return inlineStringLimit + 1;
+    }
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <vector>
+#include <map>
+#include <set>
+#include <string>
+#include <list>
+
+#include "constants.hpp"
+#include "ExpressionTree.hpp"
+
+namespace k_13 {
+class Optimizer {
+public:
+    Optimizer() = default;
+    ~Optimizer() = default;
+
+    // dead code elimination, repeated until nothing changes
+    void eliminateDeadCode(std::vector<Keyword> &keywords);
+    // common subexpression elimination. A value is available in the block that
+    // computed it and in nested blocks, until one of its variables is assigned
+    // or a label makes it reachable from elsewhere.
+    void eliminateCommonSubexpressions(std::vector<Keyword> &keywords);
+    // loop-invariant code motion. The "to" bound and pure expressions that no
+    // statement of the loop changes are computed once in front of the loop.
+    void hoistLoopInvariants(std::vector<Keyword> &keywords);
+    // upper bound of the length of every string variable that can only hold
+    // short values. Strings read by get or built in a loop have no bound.
+    void boundStringLengths(const std::vector<Keyword> &keywords, const std::vector<Literal> &literals);
+
+    // longest string kept in a fixed buffer
+    static constexpr std::size_t inlineStringLimit = 256;
+
+    int getRemovedStatements() { return removedStatements; }
+    int getRemovedDeclarations() { return removedDeclarations; }
+    int getTemporaries() { return temporaries; }
+    int getReplacedExpressions() { return replacedExpressions; }
+    int getHoistedExpressions() { return hoistedExpressions; }
+    const std::map<std::string, std::size_t> &getStringBounds() { return stringBounds; }
+    int getStringVariables() { return stringVariables; }
+
+private:
+    // expression of one statement, kept as a tree while the block is optimized
+    struct ParsedExpression {
+        std::vector<Lexem> *target = nullptr;
+        bool isString = false;
+        ExpressionNode tree{};
+        std::vector<ExpressionNode> factors{};
+        bool changed = false;
+    };
+    // where a subexpression was computed first
+    struct Site {
+        std::vector<Keyword> *keywords = nullptr;
+        int index = 0;
+        std::map<std::string, LexemType> *declarations = nullptr;
+        // types of the variables visible at the statement
+        const std::map<std::string, LexemType> *scope = nullptr;
+        int depth = 0;
+        ParsedExpression *parsed = nullptr;
+    };
+    // loop being hoisted from and the place in front of it
+    struct Loop {
+        std::set<std::string> variant{};
+        std::map<std::string, std::string> hoisted{};
+        std::vector<Keyword> *keywords = nullptr;
+        int index = 0;
+        std::map<std::string, LexemType> *declarations = nullptr;
+    };
+    struct AvailableExpression {
+        std::string temporary{};
+        ExpressionNode *node = nullptr;
+        Site site{};
+        std::set<std::string> dependencies{};
+    };
+
+    void collectUsage(const std::vector<Keyword> &keywords);
+    void collectReads(const std::vector<Lexem> &expression, std::set<std::string> &reads);
+    void compact(std::vector<Keyword> &keywords, const std::vector<bool> &removed);
+    // statements after goto up to the next used label
+    bool removeUnreachable(std::vector<Keyword> &keywords, int depth);
+    // labels nobody jumps to, jumps to the next statement and empty blocks
+    bool removeUnusedLabels(std::vector<Keyword> &keywords, int depth);
+    // stores never read anywhere or overwritten before the next read
+    bool removeDeadStores(std::vector<Keyword> &keywords);
+    bool removeUnusedVariables(std::vector<Keyword> &keywords);
+
+    void cseBlock(std::vector<Keyword> &keywords, std::map<std::string, LexemType> *declarations
+                  , std::map<std::string, LexemType> scope, int depth);
+    ParsedExpression &cseParse(std::list<ParsedExpression> &parsed, std::vector<Lexem> &expression, bool isString);
+    void cseExpression(ParsedExpression &parsed, Site site);
+    std::string cseNode(ExpressionNode &node, Site &site, bool conditional, std::set<std::string> &dependencies);
+    void cseReplace(ExpressionNode &node, const std::string &temporary);
+    void cseForget(ExpressionNode &node);
+    void cseKill(const std::set<std::string> &variables);
+    void cseLeave(int depth);
+    void insertTemporaries(std::vector<Keyword> &keywords);
+    void assignedVariables(const std::vector<Keyword> &keywords, std::set<std::string> &assigned);
+
+    void licmBlock(std::vector<Keyword> &keywords, std::map<std::string, LexemType> *declarations
+                   , std::map<std::string, LexemType> scope);
+    void licmLoop(Keyword &loop, Loop &context, const std::map<std::string, LexemType> &scope);
+    void licmStatements(std::vector<Keyword> &keywords, Loop &context, std::map<std::string, LexemType> scope);
+    bool licmExpression(std::vector<Lexem> &expression, bool isString, Loop &context, const std::map<std::string, LexemType> &scope);
+    bool licmNode(ExpressionNode &node, Loop &context, const std::map<std::string, LexemType> &scope);
+    std::string licmHoist(const ExpressionNode &node, Loop &context);
+    bool isInvariant(const ExpressionNode &node, const Loop &context, const std::map<std::string, LexemType> &scope);
+    void labelUsage(const std::vector<Keyword> &keywords, std::map<std::string, int> &references, std::set<std::string> &definitions);
+
+    void collectDeclarations(const std::vector<Keyword> &keywords, std::map<std::string, LexemType> &declarations);
+    std::size_t stringLength(const std::vector<Lexem> &expression, const std::map<std::string, LexemType> &declarations
+                             , const std::vector<Literal> &literals);
+    std::size_t factorLength(const ExpressionNode &node, const std::map<std::string, LexemType> &declarations
+                             , const std::vector<Literal> &literals);
+
+    bool terminates(const Keyword &keyword);
+    bool definesUsedLabel(const Keyword &keyword);
+    bool isEmptyBlock(const Keyword &keyword);
+
+    std::map<std::string, int> labelReferences;
+    std::set<std::string> readVariables;
+    std::set<std::string> usedVariables;
+
+    std::map<std::string, AvailableExpression> available;
+    std::map<ExpressionNode*, std::string> recorded;
+    std::map<std::string, std::string> temporaryKeys;
+    std::map<std::string, std::set<std::string>> temporaryDependencies;
+    std::map<std::vector<Keyword>*, std::vector<std::pair<int, Keyword>>> pendingTemporaries;
+    std::map<std::string, std::size_t> stringBounds;
+
+    int removedStatements = 0;
+    int removedDeclarations = 0;
+    int temporaries = 0;
+    int replacedExpressions = 0;
+    int hoistedExpressions = 0;
+    int loopTemporaries = 0;
+    int stringVariables = 0;
+};
+} // k_13
@@ -0,0 +1,246 @@
+#include "Process.hpp"
+
+#include <map>
+#include <mutex>
+#include <cstdlib>
+#include <cerrno>
+#include <filesystem>
+
+#ifdef _WIN32
+#define K13_SPAWN 0
+#else
+#define K13_SPAWN 1
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <csignal>
+#include <fcntl.h>
+
+extern char **environ;
+#endif
+
+namespace {
+    // writes to a file descriptor in blocks of 64 KiB
+    class PipeBuffer : public std::streambuf {
+    public:
+        explicit PipeBuffer(int fd_) : fd(fd_) { setp(buffer, buffer + sizeof(buffer)); }
+        ~PipeBuffer() override { sync(); }
+
+    protected:
+        int_type overflow(int_type c) override {
+            if (drain() != 0)
+                return traits_type::eof();
+            if (!traits_type::eq_int_type(c, traits_type::eof())) {
+                *pptr() = traits_type::to_char_type(c);
+                pbump(1);
+            }
+            return traits_type::not_eof(c);
+        }
+        int sync() override { return drain(); }
+
+    private:
+        int drain() {
+#if K13_SPAWN
+            const char *data = pbase();
+            while (data < pptr()) {
+                ssize_t written = write(fd, data, static_cast<std::size_t>(pptr() - data));
+                if (written < 0 && errno == EINTR)
+                    continue;
+                if (written <= 0)
+                    return -1;
+                data += written;
+            }
+#endif
+            setp(buffer, buffer + sizeof(buffer));
+            return 0;
+        }
+
+        int fd;
+        char buffer[1 << 16];
+    };
+}
+
+k_13::Process::~Process() {
+    if (pid >= 0)
+        wait();
+}
+
+std::string k_13::Process::find(const std::string &program) {
+    // PATH is searched once per program, threads building in the background share the cache
+    static std::map<std::string, std::string> found;
+    static std::mutex foundMutex;
+    std::lock_guard<std::mutex> lock(foundMutex);
+    auto cached = found.find(program);
+    if (cached != found.end())
+        return cached->second;
+    std::string result;
+    const char *path = std::getenv("PATH");
+#ifdef _WIN32
+    const char separator = ';';
+    const std::string suffix = ".exe";
+#else
+    const char separator = ':';
+    const std::string suffix;
+#endif
+    std::string directories = path ? path : "";
+    std::size_t begin = 0;
+    while (result.empty() && begin <= directories.size()) {
+        std::size_t end = directories.find(separator, begin);
+        if (end == std::string::npos)
+            end = directories.size();
+        std::filesystem::path candidate = directories.substr(begin, end - begin);
+        candidate /= program + suffix;
+        std::error_code error;
+        if (!candidate.parent_path().empty() && std::filesystem::is_regular_file(candidate, error)) {
+#if K13_SPAWN
+            if (access(candidate.c_str(), X_OK) == 0)
+#endif
+                result = candidate.string();
+        }
+        begin = end + 1;
+    }
+    found[program] = result;
+    return result;
+}
+
+int k_13::Process::start() {
+    status = -1;
+    if (arguments.empty())
+        return -1;
+#if K13_SPAWN
+    std::string executable = find(arguments.front());
+    if (executable.empty())
+        return -1;
+    std::vector<char *> argv;
+    for (auto &argument : arguments)
+        argv.push_back(argument.data());
+    argv.push_back(nullptr);
+    int fds[2] = {-1, -1};
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    if (piped) {
+        // close-on-exec from the start, a child spawned by another thread
+        // meanwhile would otherwise hold the pipe open
+#ifdef __APPLE__
+        // no pipe2 here, the flags are set right after and the window stays
+        bool opened = pipe(fds) == 0;
+        if (opened) {
+            fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+            fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+        }
+#else
+        bool opened = pipe2(fds, O_CLOEXEC) == 0;
+#endif
+        if (!opened) {
+            posix_spawn_file_actions_destroy(&actions);
+            return -1;
+        }
+        // a compiler that stops early must not kill k13c with SIGPIPE
+        std::signal(SIGPIPE, SIG_IGN);
+        posix_spawn_file_actions_adddup2(&actions, fds[0], 0);
+        posix_spawn_file_actions_addclose(&actions, fds[0]);
+        posix_spawn_file_actions_addclose(&actions, fds[1]);
+    }
+    pid_t child;
+    int error = posix_spawn(&child, executable.c_str(), &actions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    if (piped)
+        close(fds[0]);
+    if (error != 0) {
+        if (piped)
+            close(fds[1]);
+        return -1;
+    }
+    pid = child;
+    if (piped) {
+        inputFd = fds[1];
+        inputBuffer = std::make_unique<PipeBuffer>(inputFd);
+        inputStream = std::make_unique<std::ostream>(inputBuffer.get());
+    }
+#else
+    if (piped)
+        return -1;
+    pid = 0;
+#endif
+    return 0;
+}
+
+void k_13::Process::closeInput() {
+    if (inputFd < 0)
+        return;
+    inputStream->flush();
+    inputStream.reset();
+    inputBuffer.reset();
+#if K13_SPAWN
+    close(inputFd);
+#endif
+    inputFd = -1;
+}
+
+int k_13::Process::wait() {
+    closeInput();
+    if (pid < 0)
+        return -1;
+    reap(true);
+    return status;
+}
+
+bool k_13::Process::finished() {
+    if (pid < 0)
+        return true;
+    return reap(false) == 0;
+}
+
+void k_13::Process::kill() {
+#if K13_SPAWN
+    if (pid > 0)
+        ::kill(static_cast<pid_t>(pid), SIGTERM);
+#endif
+}
+
+int k_13::Process::reap(bool block) {
+#if K13_SPAWN
+    int childStatus = 0;
+    struct rusage usage {};
+    pid_t result;
+    while ((result = wait4(static_cast<pid_t>(pid), &childStatus, block ? 0 : WNOHANG, &usage)) < 0 && errno == EINTR)
+        ;
+    if (result == 0)
+        return 1;
+    pid = -1;
+    if (result < 0) {
+        status = -1;
+        return 0;
+    }
+    userSeconds = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6;
+    systemSeconds = usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+    maxResident = usage.ru_maxrss;
+    status = WIFEXITED(childStatus) ? WEXITSTATUS(childStatus) : -1;
+#else
+    // no spawn without a shell here, the command runs when it is waited for
+    (void)block;
+    pid = -1;
+    status = std::system(command().c_str());
+#endif
+    return 0;
+}
+
+int k_13::Process::run() {
+    if (start() != 0)
+        return status = -1;
+    return wait();
+}
+
+std::string k_13::Process::command() const {
+    std::string result;
+    for (auto &argument : arguments) {
+        if (!result.empty())
+            result += ' ';
+        if (argument.find_first_of(" \t\"") == std::string::npos)
+            result += argument;
+        else
+            result += '"' + argument + '"';
+    }
+    return result;
+}
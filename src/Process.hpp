@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <iostream>
+
+namespace k_13 {
+// Runs an external tool such as g++ without going through a shell. The
+// program is looked up in PATH once per process, and after wait() its exit
+// status and resource usage are available.
+class Process {
+public:
+    explicit Process(std::vector<std::string> arguments_) : arguments(std::move(arguments_)) {}
+    ~Process();
+    Process(const Process &) = delete;
+    Process &operator=(const Process &) = delete;
+
+    // path of program in PATH, empty when it isn't installed
+    static std::string find(const std::string &program);
+    // 0 when the program was started
+    int start();
+    // exit status, -1 when it couldn't be started or was killed by a signal
+    int wait();
+    // start() and wait()
+    int run();
+    // true once the program has exited and was reaped, without blocking
+    bool finished();
+    // asks a running program to stop, wait() or finished() still reap it (POSIX only)
+    void kill();
+    // exit status after wait() or finished(), -1 before
+    int getStatus() const { return status; }
+    // before start(): the child reads its stdin from input() (POSIX only)
+    void pipeInput() { piped = true; }
+    // stream into the pipe, valid between start() and closeInput()
+    std::ostream &input() { return *inputStream; }
+    // flush input() and let the child see the end of its stdin
+    void closeInput();
+
+    // command line as a shell would show it
+    std::string command() const;
+    double getUserSeconds() const { return userSeconds; }
+    double getSystemSeconds() const { return systemSeconds; }
+    // peak resident set size in KiB
+    long getMaxResident() const { return maxResident; }
+
+private:
+    std::vector<std::string> arguments;
+    bool piped = false;
+    int inputFd = -1;
+    std::unique_ptr<std::streambuf> inputBuffer;
+    std::unique_ptr<std::ostream> inputStream;
+    long pid = -1;
+    int status = -1;
+    double userSeconds = 0;
+    double systemSeconds = 0;
+    long maxResident = 0;
+
+    // 0 when the program was reaped, 1 when it still runs and block is false
+    int reap(bool block);
+};
+
+} // k_13
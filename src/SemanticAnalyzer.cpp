@@ -15,6 +15,15 @@ int k_13::SemanticAnalyzer::analyze(const std::map<std::string, std::vector<std:
     return -1;
 }
 
+bool k_13::SemanticAnalyzer::analyzeExpression(LexemType type, const std::vector<Lexem>& expression, const std::map<std::string, LexemType>& variableTable
+    , std::vector<std::string>& errors) {
+    errorMessages.clear();
+    warnings.clear();
+    checkTypes(variableTable, {std::make_pair(type, expression)});
+    errors.insert(errors.end(), errorMessages.begin(), errorMessages.end());
+    return errorMessages.empty();
+}
+
 bool k_13::SemanticAnalyzer::checkIdentifiers(const std::map<std::string, std::vector<std::pair<int, ExpressionType>>>& identifiers
     , const std::map<std::string, std::list<std::pair<int, ExpressionType>>>& labels) {
     errorMessages.clear();
@@ -177,6 +186,22 @@ bool k_13::SemanticAnalyzer::checkLabels(const std::map<std::string, std::list<s
 bool k_13::SemanticAnalyzer::checkVariables(const std::map<std::string, LexemType>& variableTable, const std::list<std::pair<LexemType, std::vector<Lexem>>>& expressions) {
     errorMessages.clear();
     warnings.clear();
+    checkTypes(variableTable, expressions);
+    if (errorMessages.empty()) {
+        return true;
+    }
+    else {
+        for (auto error : errorMessages) {
+            std::cout << error << std::endl;
+        }
+        for (auto warning : warnings) {
+            std::cout << warning << std::endl;
+        }
+        return false;
+    }
+}
+
+void k_13::SemanticAnalyzer::checkTypes(const std::map<std::string, LexemType>& variableTable, const std::list<std::pair<LexemType, std::vector<Lexem>>>& expressions) {
     for (auto expression : expressions) {
         pos = 0;
         bool concatOp = true, hasString = false, hasComp = false, concatOpB = true, hasStringB = false;
@@ -273,18 +298,6 @@ bool k_13::SemanticAnalyzer::checkVariables(const std::map<std::string, LexemTyp
             break;
         }
     }
-    if (errorMessages.empty()) {
-        return true;
-    }
-    else {
-        for (auto error : errorMessages) {
-            std::cout << error << std::endl;
-        }
-        for (auto warning : warnings) {
-            std::cout << warning << std::endl;
-        }
-        return false;
-    }
 }
 
 std::tuple<bool, bool, bool> k_13::SemanticAnalyzer::checkExpression(const std::vector<Lexem>& expression, const std::map<std::string, LexemType>& variableTable) {
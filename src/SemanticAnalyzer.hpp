@@ -17,12 +17,17 @@ public:
                 , const std::map<std::string, std::list<std::pair<int, ExpressionType>>> &labels
                 , const std::map<std::string, LexemType> &variableTable
                 , const std::list<std::pair<LexemType, std::vector<Lexem>>> &expressions);
+    // type checks of a single expression, for a compiler that checks each statement as it reads it.
+    // The messages are added to errors instead of being printed
+    bool analyzeExpression(LexemType type, const std::vector<Lexem> &expression, const std::map<std::string, LexemType> &variableTable
+                           , std::vector<std::string> &errors);
 
 private:
     bool checkIdentifiers(const std::map<std::string, std::vector<std::pair<int, ExpressionType>>> &identifiers
                           , const std::map<std::string, std::list<std::pair<int, ExpressionType>>> &labels);
     bool checkLabels(const std::map<std::string, std::list<std::pair<int, ExpressionType>>> &labels);
     bool checkVariables(const std::map<std::string, LexemType> &variableTable, const std::list<std::pair<LexemType, std::vector<Lexem>>> &expressions);
+    void checkTypes(const std::map<std::string, LexemType> &variableTable, const std::list<std::pair<LexemType, std::vector<Lexem>>> &expressions);
 
     std::tuple<bool, bool, bool> checkExpression(const std::vector<Lexem> &expression, const std::map<std::string, LexemType> &variableTable);
     void checkVariable(const std::tuple<bool, bool, bool> &varParams, std::vector<std::pair<int, ExpressionType>> &identifiers
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+namespace k_13 {
+// SHA-256 of data fed in pieces, used to name cache entries by their content
+class Sha256 {
+public:
+    Sha256();
+    ~Sha256() = default;
+
+    void update(std::string_view data);
+    // digest as 64 lowercase hex digits, the object can't be updated afterwards
+    std::string hex();
+    static std::string hex(std::string_view data);
+
+private:
+    void block(const std::uint8_t *data);
+
+    std::array<std::uint32_t, 8> state;
+    std::array<std::uint8_t, 64> buffer{};
+    std::size_t buffered = 0;
+    std::uint64_t length = 0;
+};
+
+} // k_13
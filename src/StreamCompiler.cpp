@@ -0,0 +1,805 @@
+#include "StreamCompiler.hpp"
+
+#include <algorithm>
+#include <filesystem>
+
+int k_13::StreamCompiler::compile(const std::string &filename, const std::string &outPath) {
+    source.open(filename);
+    if (!source.is_open())
+        return -2;
+    std::cout << "[INFO] Start streaming compilation" << std::endl;
+    next();
+    next();
+    program_declaration();
+    std::filesystem::path outputFile = outPath;
+    outputFile /= programName + ".cpp";
+    if (!failed) {
+        output.open(outputFile);
+        if (!output.is_open()) {
+            std::cout << "[ERROR] Can't create " << outputFile.string() << std::endl;
+            failed = true;
+        }
+        else
+            generator.streamBegin(file);
+    }
+    blocks.push_back({});
+    program_body(LexemType::FINISH);
+    report();
+    if (output.is_open()) {
+        if (!failed && !file.flush())
+            failed = true;
+        output.close();
+        if (failed || !output) {
+            std::error_code error;
+            std::filesystem::remove(outputFile, error);
+        }
+    }
+    return failed ? -1 : 0;
+}
+
+void k_13::StreamCompiler::next() {
+    if (!currentEnd)
+        previous = current;
+    current = following;
+    currentEnd = followingEnd;
+    std::string token;
+    int tokenLine = line;
+    if (!followingEnd && read(token, tokenLine))
+        following = classify(token, tokenLine);
+    else {
+        // past the end the last lexem stays in place, so messages keep its line
+        following = {LexemType::UNKNOWN, "", line};
+        followingEnd = true;
+    }
+    consumed++;
+}
+
+// the tokens of the LexicalAnalyzer: words, numbers, strings in quotes, the
+// two character operators and any other single character. $$ starts a comment.
+bool k_13::StreamCompiler::read(std::string &token, int &tokenLine) {
+    char ch;
+    while (source.get(ch)) {
+        if (ch == '\n') {
+            line++;
+            continue;
+        }
+        if (ch == ' ' || ch == '\t')
+            continue;
+        if (ch == '$' && source.peek() == '$') {
+            while (source.get(ch) && ch != '\n') {}
+            if (ch == '\n')
+                line++;
+            continue;
+        }
+        tokenLine = line;
+        token = ch;
+        auto letter = [](int c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'); };
+        auto digit = [](int c) { return c >= '0' && c <= '9'; };
+        if (letter(ch)) {
+            while (letter(source.peek()) || digit(source.peek()) || source.peek() == '_')
+                token += static_cast<char>(source.get());
+        }
+        else if (digit(ch)) {
+            while (digit(source.peek()))
+                token += static_cast<char>(source.get());
+        }
+        else if (ch == '"') {
+            while (source.get(ch)) {
+                token += ch;
+                if (ch == '"')
+                    break;
+            }
+        }
+        else {
+            std::string pair = token + static_cast<char>(source.peek());
+            if (pair == ":=" || pair == "<>" || pair == "&&" || pair == "||" || pair == "!!")
+                token += static_cast<char>(source.get());
+        }
+        return true;
+    }
+    return false;
+}
+
+k_13::Lexem k_13::StreamCompiler::classify(const std::string &token, int tokenLine) {
+    auto operator_ = constants.operators_k13.find(token);
+    if (operator_ != constants.operators_k13.end())
+        return {operator_->second, token, tokenLine};
+    auto keyword = constants.keywords_k13.find(token);
+    if (keyword != constants.keywords_k13.end())
+        return {keyword->second, token, tokenLine};
+    if (token.find_first_not_of("0123456789") == std::string::npos) {
+        long number = 0;
+        for (char ch : token) {
+            number = number * 10 + (ch - '0');
+            if (number > 32767)
+                return unknown(token, tokenLine);
+        }
+        return {LexemType::NUMBER, token, tokenLine, static_cast<int>(number)};
+    }
+    if (token.size() > 1 && token.front() == '"' && token.back() == '"') {
+        // every occurrence is a literal of its own, there's no table to intern them in
+        literals.push_back({literalId, token});
+        return {LexemType::STRING_LITERAL, std::to_string(literalId++), tokenLine};
+    }
+    if (token[0] >= 'a' && token[0] <= 'z' && token.length() <= 6)
+        return {LexemType::IDENTIFIER, token, tokenLine};
+    return unknown(token, tokenLine);
+}
+
+// numbered like the LexicalAnalyzer does, messages other than 'Unknown statement' give the number
+k_13::Lexem k_13::StreamCompiler::unknown(const std::string &token, int tokenLine) {
+    unknownLexems.push_back(token);
+    return {LexemType::UNKNOWN, std::to_string(unknownLexems.size()), tokenLine};
+}
+
+bool k_13::StreamCompiler::match(LexemType expectedType) {
+    if (!atEnd() && current.type == expectedType) {
+        next();
+        return true;
+    }
+    return false;
+}
+
+void k_13::StreamCompiler::semicolon() {
+    if (match(LexemType::SEMICOLON))
+        return;
+    if (!atEnd())
+        syntaxError(previous.line, "Missing ';' before statement " + current.value);
+    else
+        syntaxError(previous.line, "Missing ';' after statement " + previous.value);
+}
+
+void k_13::StreamCompiler::program_declaration() {
+    if (!match(LexemType::PROGRAM))
+        syntaxError(current.line, "Expected 'program' keyword before program name");
+    if (!match(LexemType::IDENTIFIER))
+        syntaxError(current.line, "Expected program name after 'program' keyword");
+    programName = previous.value;
+    semicolon();
+}
+
+void k_13::StreamCompiler::program_body(LexemType end) {
+    do {
+        std::size_t before = consumed;
+        statement();
+        // a statement that can't start here ends the body, the caller reports it
+        if (atEnd() || consumed == before)
+            break;
+    }
+    while (current.type != end);
+}
+
+void k_13::StreamCompiler::statement() {
+    if (atEnd())
+        return;
+    switch (current.type) {
+    case LexemType::START:
+        compound_statement();
+        break;
+    case LexemType::GET:
+        get_expression();
+        semicolon();
+        break;
+    case LexemType::PUT:
+        put_expression();
+        semicolon();
+        break;
+    case LexemType::IF:
+        if_expression();
+        break;
+    case LexemType::GOTO:
+        emit({LexemType::GOTO, {}, {}, goto_expression()});
+        semicolon();
+        break;
+    case LexemType::FOR:
+        for_expression();
+        semicolon();
+        break;
+    case LexemType::IDENTIFIER:
+        if (!followingEnd && following.type == LexemType::ASSIGN)
+            assign_expression();
+        else
+            emit({LexemType::LABEL, {}, {}, end_goto_expression()});
+        semicolon();
+        break;
+    case LexemType::FINISH:
+        return;
+    case LexemType::UNKNOWN:
+        syntaxError(current.line, "Unknown statement " + unknownLexems[std::stoi(current.value) - 1]);
+        next();
+        return;
+    default:
+        syntaxError(current.line, "Unknown statement " + current.value);
+        next();
+        return;
+    }
+    statements++;
+}
+
+void k_13::StreamCompiler::compound_statement() {
+    if (!match(LexemType::START))
+        syntaxError(current.line, "Expected 'start' keyword before compound statement");
+    Keyword compound;
+    compound.keyword = LexemType::START;
+    openBlock();
+    compound.variables = variable_declaration();
+    emitOpen(compound);
+    program_body(LexemType::FINISH);
+    if (!match(LexemType::FINISH))
+        syntaxError(previous.line, "Expected 'finish' keyword after compound statement");
+    emitClose(compound);
+    closeBlock();
+}
+
+std::map<std::string, k_13::LexemType> k_13::StreamCompiler::variable_declaration() {
+    std::map<std::string, LexemType> declaredVariables;
+    if (!match(LexemType::VAR))
+        syntaxError(current.line, "Expected 'var' keyword before variable segment");
+    if (!atEnd() && (current.type == LexemType::INT || current.type == LexemType::BOOL || current.type == LexemType::STRING))
+        declaredVariables = variable_list();
+    semicolon();
+    return declaredVariables;
+}
+
+// the names are declared as they are read, a name given twice is reported here
+std::map<std::string, k_13::LexemType> k_13::StreamCompiler::variable_list() {
+    std::map<std::string, LexemType> declaredVariables;
+    LexemType type = current.type;
+    next();
+    if (!match(LexemType::IDENTIFIER))
+        syntaxError(current.line, "Expected identifier after variable type");
+    else {
+        declare(previous, previous.line, type);
+        declaredVariables[previous.value] = type;
+    }
+    while (!atEnd() && current.type == LexemType::COMMA) {
+        next();
+        // a name without a type of its own is recorded at the line of the comma
+        int line = previous.line;
+        if (!match(LexemType::INT) && !match(LexemType::BOOL) && !match(LexemType::STRING)) {
+            if (current.type != LexemType::IDENTIFIER)
+                syntaxError(current.line, "Expected variable type before identifier");
+        }
+        else {
+            type = previous.type;
+            line = current.line;
+        }
+        if (!match(LexemType::IDENTIFIER)) {
+            syntaxError(current.line, "Expected identifier after variable type");
+            continue;
+        }
+        declare(previous, line, type);
+        declaredVariables[previous.value] = type;
+    }
+    return declaredVariables;
+}
+
+void k_13::StreamCompiler::get_expression() {
+    next();
+    if (!match(LexemType::LPAREN))
+        syntaxError(current.line, "Expected '(' before identifier");
+    if (!match(LexemType::IDENTIFIER))
+        syntaxError(current.line, "Expected identifier after 'get' statement");
+    else
+        use(previous.value, previous.line, ExpressionType::INPUT);
+    Keyword statm;
+    statm.keyword = LexemType::GET;
+    statm.label = previous.value;
+    if (!match(LexemType::RPAREN))
+        syntaxError(current.line, "Expected ')' after identifier");
+    emit(statm);
+}
+
+void k_13::StreamCompiler::put_expression() {
+    next();
+    if (!match(LexemType::LPAREN))
+        syntaxError(current.line, "Expected '(' before identifier");
+    expression.clear();
+    if (!string_expression())
+        syntaxError(current.line, "Expected string expression after '(' statement");
+    else
+        check(LexemType::STRING);
+    Keyword statm;
+    statm.keyword = LexemType::PUT;
+    statm.expression1 = std::move(expression);
+    if (!match(LexemType::RPAREN))
+        syntaxError(current.line, "Expected ')' after expression in 'put' statement");
+    emit(statm);
+}
+
+void k_13::StreamCompiler::assign_expression() {
+    Keyword statm;
+    statm.keyword = LexemType::ASSIGN;
+    statm.label = current.value;
+    use(statm.label, previous.line, ExpressionType::ASSIGNMENT);
+    // the lookup of the SyntaxAnalyzer adds a name it doesn't know to its table
+    bool isString = types.try_emplace(statm.label, LexemType::PROGRAM).first->second == LexemType::STRING;
+    next();
+    if (!match(LexemType::ASSIGN))
+        syntaxError(current.line, "Expected ':=' after identifier");
+    expression.clear();
+    if (isString) {
+        if (!string_expression())
+            syntaxError(current.line, "Expected string expression after '(' statement");
+        else
+            check(LexemType::STRING);
+    }
+    else {
+        if (!logical_expression())
+            syntaxError(current.line, "Expected logical expression after '(' statement");
+        else
+            check(LexemType::BOOL);
+    }
+    statm.expression1 = std::move(expression);
+    emit(statm);
+}
+
+std::string k_13::StreamCompiler::goto_expression() {
+    if (!match(LexemType::GOTO))
+        syntaxError(current.line, "Expected 'goto' keyword before identifier");
+    if (!match(LexemType::IDENTIFIER))
+        syntaxError(current.line, "Expected identifier after 'goto' statement");
+    else
+        jump(previous, ExpressionType::GOTO);
+    return previous.value;
+}
+
+std::string k_13::StreamCompiler::end_goto_expression() {
+    if (!match(LexemType::IDENTIFIER))
+        syntaxError(current.line, "Expected identifier after 'end' statement");
+    else
+        jump(previous, ExpressionType::LABEL);
+    return previous.value;
+}
+
+// the head goes out before the block is read, the jumps behind it after
+void k_13::StreamCompiler::if_expression() {
+    Keyword statm;
+    statm.keyword = LexemType::IF;
+    next();
+    if (!match(LexemType::LPAREN))
+        syntaxError(current.line, "Expected '(' before condition expression");
+    expression.clear();
+    if (!logical_expression())
+        syntaxError(current.line, "Expected logical expression after '(' statement");
+    else
+        check(LexemType::BOOL);
+    statm.expression1 = std::move(expression);
+    if (!match(LexemType::RPAREN))
+        syntaxError(current.line, "Expected ')' after condition expression");
+    statm.label = goto_expression();
+    semicolon();
+    int startLine = previous.line;
+    if (!atEnd() && current.type != LexemType::START) {
+        std::string ifErrors;
+        int errorLine = current.line;
+        while (!atEnd() && current.type != LexemType::START) {
+            ifErrors += current.value + " ";
+            next();
+        }
+        // both go under the line the SyntaxAnalyzer stops at
+        if (atEnd()) {
+            syntaxError(startLine, "Expected 'start' keyword after 'if' statement", previous.line);
+            return;
+        }
+        syntaxError(startLine, "Unknown statements before 'start' keyword: " + ifErrors + "\n", errorLine);
+    }
+    emitOpen(statm);
+    compound_statement();
+    statm.label2 = goto_expression();
+    semicolon();
+    statm.label3 = end_goto_expression();
+    semicolon();
+    emitClose(statm);
+}
+
+void k_13::StreamCompiler::for_expression() {
+    Keyword statm;
+    statm.keyword = LexemType::FOR;
+    next();
+    if (!match(LexemType::IDENTIFIER))
+        syntaxError(current.line, "Expected identifier after 'for' statement");
+    statm.label = previous.value;
+    use(statm.label, previous.line, ExpressionType::STARTFOR);
+    if (!match(LexemType::ASSIGN))
+        syntaxError(current.line, "Expected ':=' after identifier");
+    expression.clear();
+    if (!arithmetic_expression())
+        syntaxError(current.line, "Expected arithmetic expression after ':=' statement");
+    statm.expression1 = std::move(expression);
+    if (!match(LexemType::TO))
+        syntaxError(current.line, "Expected 'to' keyword after identifier");
+    expression.clear();
+    if (!arithmetic_expression())
+        syntaxError(current.line, "Expected arithmetic expression after 'to' statement");
+    statm.expression2 = std::move(expression);
+    emitOpen(statm);
+    program_body(LexemType::NEXT);
+    if (!match(LexemType::NEXT))
+        syntaxError(current.line, "Expected 'next' keyword after condition expression");
+    if (!match(LexemType::IDENTIFIER))
+        syntaxError(current.line, "Expected identifier after 'next' statement");
+    else if (previous.value != statm.label)
+        syntaxError(current.line, "Expected identifier " + statm.label + " after 'next' statement");
+    use(statm.label, previous.line, ExpressionType::ENDFOR);
+    emitClose(statm);
+}
+
+bool k_13::StreamCompiler::arithmetic_expression() {
+    bool result = term();
+    while (!atEnd() && (current.type == LexemType::ADD || current.type == LexemType::SUB)) {
+        expression.push_back(current);
+        next();
+        result &= term();
+    }
+    return result;
+}
+
+bool k_13::StreamCompiler::term() {
+    bool result = factor();
+    while (!atEnd() && (current.type == LexemType::MUL || current.type == LexemType::DIV || current.type == LexemType::MOD)) {
+        expression.push_back(current);
+        next();
+        result &= factor();
+    }
+    return result;
+}
+
+bool k_13::StreamCompiler::factor() {
+    if (atEnd())
+        return false;
+    switch (current.type) {
+    case LexemType::IDENTIFIER:
+        use(current.value, previous.line, ExpressionType::EXPRESSION);
+        [[fallthrough]];
+    case LexemType::NUMBER:
+    case LexemType::TRUE:
+    case LexemType::FALSE:
+        expression.push_back(current);
+        next();
+        return true;
+    case LexemType::LPAREN: {
+        expression.push_back(current);
+        next();
+        bool result = logical_expression();
+        if (!match(LexemType::RPAREN))
+            return false;
+        expression.push_back(previous);
+        return result;
+    }
+    default:
+        next();
+        return false;
+    }
+}
+
+bool k_13::StreamCompiler::logical_expression() {
+    bool result = logical_term();
+    while (!atEnd() && current.type == LexemType::OR) {
+        expression.push_back(current);
+        next();
+        result &= logical_term();
+    }
+    return result;
+}
+
+bool k_13::StreamCompiler::logical_term() {
+    bool result = equality_expression();
+    while (!atEnd() && current.type == LexemType::AND) {
+        expression.push_back(current);
+        next();
+        result &= equality_expression();
+    }
+    return result;
+}
+
+bool k_13::StreamCompiler::equality_expression() {
+    bool result = true;
+    for (int side = 0; side < 2; side++) {
+        if (side == 1) {
+            if (atEnd() || (current.type != LexemType::EQUAL && current.type != LexemType::NEQUAL))
+                break;
+            expression.push_back(current);
+            next();
+        }
+        if (!atEnd() && current.type == LexemType::NOT) {
+            expression.push_back(current);
+            next();
+            if (!match(LexemType::LPAREN))
+                syntaxError(current.line, "Expected '(' after NOT operator");
+            expression.push_back(previous);
+            result &= logical_expression();
+            if (!match(LexemType::RPAREN))
+                syntaxError(current.line, "Expected ')' after expression");
+            expression.push_back(previous);
+        }
+        else
+            result &= relational_expression();
+    }
+    return result;
+}
+
+bool k_13::StreamCompiler::relational_expression() {
+    bool result = true;
+    for (int side = 0; side < 2; side++) {
+        if (side == 1) {
+            if (atEnd() || (current.type != LexemType::LESS && current.type != LexemType::GREATER))
+                break;
+            expression.push_back(current);
+            next();
+        }
+        if (!atEnd() && current.type == LexemType::STRING_LITERAL) {
+            expression.push_back(current);
+            next();
+        }
+        else if (!arithmetic_expression()) {
+            syntaxError(current.line, "Expected expression");
+            result = false;
+        }
+    }
+    return result;
+}
+
+bool k_13::StreamCompiler::string_expression() {
+    bool result = string_factor();
+    while (!atEnd() && current.type == LexemType::ADD) {
+        expression.push_back(current);
+        next();
+        result &= string_factor();
+    }
+    return result;
+}
+
+bool k_13::StreamCompiler::string_factor() {
+    if (atEnd())
+        return false;
+    switch (current.type) {
+    case LexemType::IDENTIFIER:
+        use(current.value, previous.line, ExpressionType::EXPRESSION);
+        [[fallthrough]];
+    case LexemType::STRING_LITERAL:
+    case LexemType::NUMBER:
+    case LexemType::TRUE:
+    case LexemType::FALSE:
+        expression.push_back(current);
+        next();
+        return true;
+    case LexemType::LPAREN: {
+        expression.push_back(current);
+        next();
+        bool result = logical_expression();
+        if (!match(LexemType::RPAREN))
+            return false;
+        expression.push_back(previous);
+        return result;
+    }
+    default:
+        next();
+        return false;
+    }
+}
+
+void k_13::StreamCompiler::declare(const Lexem &identifier, int line, LexemType type) {
+    use(identifier.value, line, ExpressionType::VARIABLE);
+    types[identifier.value] = type;
+    if (visible.try_emplace(identifier.value, type).second)
+        blocks.back().declared.push_back(identifier.value);
+}
+
+// the checks of the SemanticAnalyzer for one appearance of a variable
+void k_13::StreamCompiler::use(const std::string &name, int line, ExpressionType type) {
+    auto [found, added] = names.try_emplace(name);
+    Name &entry = found->second;
+    if (added) {
+        entry.line = line;
+        entry.serial = serials;
+        entry.scopes.push_back({});
+    }
+    Scope &inner = scope(entry);
+    std::string at = " at line " + std::to_string(line) + ": Identifier " + name;
+    switch (type) {
+    case ExpressionType::ASSIGNMENT:
+    case ExpressionType::INPUT:
+        if (!inner.declared)
+            entry.errors.push_back("\tSemantic error" + at + " is not declared");
+        if (inner.counter)
+            entry.warnings.push_back("\tWarning" + at + " is used in for loop. Possible undefined behavior");
+        inner.initialized = true;
+        break;
+    case ExpressionType::STARTFOR:
+        if (inner.declared)
+            entry.warnings.push_back("\tWarning" + at + " is already declared. Possible undefined behavior");
+        entry.declared = true;
+        inner.counter = true;
+        break;
+    case ExpressionType::ENDFOR:
+        inner.counter = false;
+        break;
+    case ExpressionType::VARIABLE:
+        if (inner.declared)
+            entry.errors.push_back("\tSemantic error" + at + " is already declared");
+        else if (inner.counter)
+            entry.errors.push_back("\tWarning" + at + " is used in for loop. Redeclaration is unacceptable");
+        entry.declared = true;
+        inner.declared = true;
+        break;
+    default:
+        if (!inner.declared)
+            entry.errors.push_back("\tSemantic error" + at + " is not declared");
+        else if (!inner.initialized)
+            // the message of the SemanticAnalyzer, with its two spaces
+            entry.errors.push_back("\tSemantic error at line  " + std::to_string(line) + ": Identifier " + name + " is not initialized");
+        if (inner.counter)
+            entry.warnings.push_back("\tWarning" + at + " is used in for loop. Possible undefined behavior");
+        break;
+    }
+    if (!entry.errors.empty())
+        failed = true;
+}
+
+// the scope of the innermost block, once the ones of closed blocks are dropped
+k_13::StreamCompiler::Scope &k_13::StreamCompiler::scope(Name &name) {
+    while (name.scopes.size() > 1) {
+        const Scope &last = name.scopes.back();
+        if (last.level < blocks.size() && blocks[last.level].serial == last.serial)
+            break;
+        name.scopes.pop_back();
+    }
+    const Block &block = blocks.back();
+    if (block.serial > name.serial && name.scopes.back().serial != block.serial) {
+        Scope outer = name.scopes.back();
+        name.scopes.push_back({blocks.size() - 1, block.serial, outer.declared, outer.initialized, false});
+    }
+    return name.scopes.back();
+}
+
+// a label (type LABEL) or a jump to it (GOTO). The scope check needs the last
+// definition of the label, it's done when the program has been read
+void k_13::StreamCompiler::jump(const Lexem &label, ExpressionType type) {
+    auto [found, added] = labels.try_emplace(label.value);
+    Label &entry = found->second;
+    if (added) {
+        entry.line = label.line;
+        entry.level = blocks.size();
+        entry.reached = reached;
+        entry.opened = opened;
+    }
+    int depth = static_cast<int>(blocks.size()) - static_cast<int>(entry.level);
+    int at = position(entry, depth);
+    if (type == ExpressionType::LABEL) {
+        if (entry.defined) {
+            entry.errors.push_back("\tSemantic error at line " + std::to_string(label.line) + ": Identifier " + label.value + " is already declared");
+            failed = true;
+        }
+        entry.defined = true;
+        entry.depth = depth;
+        entry.position = at;
+    }
+    entry.uses.emplace_back(depth, at);
+}
+
+// lastPositionAtDepth of the SemanticAnalyzer, from the blocks opened and
+// closed at the level of the depth since the label first appeared
+int k_13::StreamCompiler::position(Label &label, int depth) {
+    std::size_t level = blocks.size();
+    auto since = [level](const std::vector<std::size_t> &now, const std::vector<std::size_t> &before) {
+        return (level < now.size() ? now[level] : 0) - (level < before.size() ? before[level] : 0);
+    };
+    if (depth == 0)
+        return static_cast<int>(since(opened, label.opened));
+    std::size_t events = since(reached, label.reached);
+    bool byBlock = label.byBlock.try_emplace(depth, events > 0).first->second;
+    return static_cast<int>(events) - (byBlock ? 1 : 0);
+}
+
+void k_13::StreamCompiler::openBlock() {
+    blocks.push_back({++serials, {}});
+    maxDepth = std::max(maxDepth, blocks.size() - 1);
+    if (reached.size() <= blocks.size()) {
+        reached.resize(blocks.size() + 1);
+        opened.resize(blocks.size() + 1);
+    }
+    reached[blocks.size()]++;
+    opened[blocks.size()]++;
+}
+
+// the variables of the block go away
+void k_13::StreamCompiler::closeBlock() {
+    for (auto &name : blocks.back().declared)
+        visible.erase(name);
+    blocks.pop_back();
+    reached[blocks.size()]++;
+}
+
+// the SemanticAnalyzer looks the variables of a logical expression up, one
+// that names something it never heard of can't be checked
+void k_13::StreamCompiler::check(LexemType type) {
+    if (type == LexemType::BOOL) {
+        for (auto &lexem : expression) {
+            if (lexem.type == LexemType::IDENTIFIER && !types.contains(lexem.value))
+                return;
+        }
+    }
+    if (!semantic.analyzeExpression(type, expression, types, typeErrors))
+        failed = true;
+}
+
+// the messages in the order of the SyntaxAnalyzer and the SemanticAnalyzer: the
+// latter only runs without syntax errors, and a check prints its warnings only
+// when it has errors
+void k_13::StreamCompiler::report() {
+    if (!syntaxErrors.empty()) {
+        for (auto &message : syntaxErrors)
+            std::cerr << message.second << std::endl;
+        return;
+    }
+    auto print = [this](const std::vector<std::string> &errors, const std::vector<std::string> &warnings) {
+        if (errors.empty())
+            return;
+        failed = true;
+        for (auto &error : errors)
+            std::cout << error << std::endl;
+        for (auto &warning : warnings)
+            std::cout << warning << std::endl;
+    };
+    std::vector<std::string> errors, warnings;
+    for (auto &[name, entry] : names) {
+        std::string at = "\tSemantic error at line " + std::to_string(entry.line) + ": Identifier " + name;
+        if (labels.contains(name)) {
+            errors.push_back(at + " is a label");
+            continue;
+        }
+        errors.insert(errors.end(), entry.errors.begin(), entry.errors.end());
+        warnings.insert(warnings.end(), entry.warnings.begin(), entry.warnings.end());
+        if (!entry.declared)
+            errors.push_back(at + " is not declared");
+    }
+    print(errors, warnings);
+    errors.clear();
+    for (auto &[name, entry] : labels) {
+        errors.insert(errors.end(), entry.errors.begin(), entry.errors.end());
+        if (!entry.defined) {
+            errors.push_back("\tSemantic error at line " + std::to_string(entry.line) + ": Label " + name + " is not declared");
+            continue;
+        }
+        for (auto &use : entry.uses) {
+            // the SemanticAnalyzer gives the depth for the line
+            if (use.first < entry.depth || (use.first == entry.depth && use.second != entry.position))
+                errors.push_back("\tSemantic error at line " + std::to_string(use.first) + ": Label " + name + " is used out of scope");
+        }
+    }
+    print(errors, {});
+    print(typeErrors, {});
+}
+void k_13::StreamCompiler::emit(const Keyword &keyword) {
+    emitLiterals();
+    if (!failed)
+        generator.streamStatement(keyword, visible, file);
+}
+
+void k_13::StreamCompiler::emitOpen(const Keyword &keyword) {
+    emitLiterals();
+    if (!failed)
+        generator.streamOpen(keyword, visible, file);
+}
+
+void k_13::StreamCompiler::emitClose(const Keyword &keyword) {
+    emitLiterals();
+    if (!failed)
+        generator.streamClose(keyword, file);
+}
+
+// declared just in front of the statement, the lexem after it is never a literal
+void k_13::StreamCompiler::emitLiterals() {
+    if (literals.empty())
+        return;
+    if (!failed)
+        generator.streamLiterals(literals, file);
+    literals.clear();
+}
+
+// the first error of a line is kept, like the SyntaxAnalyzer does
+void k_13::StreamCompiler::syntaxError(int line, const std::string &message, int key) {
+    failed = true;
+    syntaxErrors.try_emplace(key, "\tSyntax error at line " + std::to_string(line) + ": " + message);
+}
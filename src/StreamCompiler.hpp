@@ -0,0 +1,177 @@
+#pragma once
+
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "constants.hpp"
+#include "Generator.hpp"
+#include "SemanticAnalyzer.hpp"
+
+namespace k_13 {
+// compiles a program while reading it. Each statement is lexed, parsed, checked
+// against the variables and labels seen so far and written out as C++ before the
+// next one is read, so the memory used follows the nesting depth, the number of
+// names and labels and the jumps to the labels instead of the length of the
+// program. The grammar, the rules and the messages are those of the
+// SyntaxAnalyzer and the SemanticAnalyzer: messages are held back to the end of
+// the program and come out in the same order, semantic errors only when there
+// are no syntax errors.
+class StreamCompiler {
+public:
+    StreamCompiler() = default;
+    ~StreamCompiler() = default;
+
+    // writes <program name>.cpp to outPath. 0 when it was written, -1 on errors
+    // (no file is left behind), -2 when the source can't be read
+    int compile(const std::string &filename, const std::string &outPath);
+    void setOptions(const GeneratorOptions &options) { generator.setOptions(options); }
+    const std::string &getProgramName() const { return programName; }
+    std::size_t getStatements() const { return statements; }
+    // deepest nesting of blocks, the program block is 1
+    std::size_t getMaxDepth() const { return maxDepth; }
+    // bytes of C++ written
+    std::size_t getEmitted() const { return file.size(); }
+
+private:
+    struct Block {
+        std::size_t serial = 0;
+        std::vector<std::string> declared;
+    };
+    // what a block knows of a variable, a copy of the scope around it made when
+    // the block first uses the variable
+    struct Scope {
+        std::size_t level = 0;
+        std::size_t serial = 0;
+        bool declared = false;
+        bool initialized = false;
+        bool counter = false;
+    };
+    // the SemanticAnalyzer only sees the blocks opened after a name first
+    // appears, the ones it is inside of then don't take its declaration away
+    struct Name {
+        int line = 0;
+        // blocks opened before the name appeared have serials up to this one
+        std::size_t serial = 0;
+        bool declared = false;
+        // the first one is never left
+        std::vector<Scope> scopes;
+        std::vector<std::string> errors;
+        std::vector<std::string> warnings;
+    };
+    // depth and position are those of the SemanticAnalyzer: blocks entered
+    // since the label first appeared and the block's place among its siblings
+    struct Label {
+        int line = 0;
+        std::size_t level = 0;
+        // blocks reached and opened at each level before the label appeared
+        std::vector<std::size_t> reached;
+        std::vector<std::size_t> opened;
+        // depths a block got to before the label did, their positions count from 0 at that block
+        std::map<int, bool> byBlock;
+        bool defined = false;
+        int depth = 0;
+        int position = 0;
+        // depth and position of the label and of every jump to it
+        std::vector<std::pair<int, int>> uses;
+        std::vector<std::string> errors;
+    };
+
+    // lexems, current and the one after it are all that is kept of the source
+    void next();
+    bool read(std::string &token, int &tokenLine);
+    Lexem classify(const std::string &token, int tokenLine);
+    Lexem unknown(const std::string &token, int tokenLine);
+    bool match(LexemType expectedType);
+    bool atEnd() const { return currentEnd; }
+
+    void program_declaration();
+    void program_body(LexemType end);
+    void statement();
+    void compound_statement();
+    std::map<std::string, LexemType> variable_declaration();
+    std::map<std::string, LexemType> variable_list();
+    void get_expression();
+    void put_expression();
+    void assign_expression();
+    std::string goto_expression();
+    std::string end_goto_expression();
+    void if_expression();
+    void for_expression();
+    void semicolon();
+
+    bool logical_expression();
+    bool logical_term();
+    bool equality_expression();
+    bool relational_expression();
+    bool arithmetic_expression();
+    bool term();
+    bool factor();
+    bool string_expression();
+    bool string_factor();
+
+    void declare(const Lexem &identifier, int line, LexemType type);
+    void use(const std::string &name, int line, ExpressionType type);
+    Scope &scope(Name &name);
+    void jump(const Lexem &label, ExpressionType type);
+    int position(Label &label, int depth);
+    void openBlock();
+    void closeBlock();
+    void check(LexemType type);
+    void report();
+
+    // code of a statement, or of the head and tail around the statements of a block
+    void emit(const Keyword &keyword);
+    void emitOpen(const Keyword &keyword);
+    void emitClose(const Keyword &keyword);
+    void emitLiterals();
+
+    void syntaxError(int line, const std::string &message) { syntaxError(line, message, line); }
+    // a message goes under the line of key, the first one of a line is kept
+    void syntaxError(int line, const std::string &message, int key);
+
+    constants_k13 constants;
+    Generator generator;
+    SemanticAnalyzer semantic;
+    std::ifstream source;
+    std::ofstream output;
+    // written to output a block at a time
+    Emitter file{&output, 1 << 16};
+
+    Lexem previous;
+    Lexem current;
+    Lexem following;
+    bool currentEnd = false;
+    bool followingEnd = false;
+    int line = 1;
+    std::size_t consumed = 0;
+    int literalId = 1;
+    // literals read since the last statement was written
+    std::vector<Literal> literals;
+    // the text of the unknown lexems, whose values are their numbers
+    std::vector<std::string> unknownLexems;
+
+    std::string programName;
+    std::vector<Lexem> expression;
+
+    // the variables of the blocks around the statement, for the generator
+    std::map<std::string, LexemType> visible;
+    // the variableTable of the SyntaxAnalyzer, the last type a name was declared with
+    std::map<std::string, LexemType> types;
+    std::vector<Block> blocks;
+    std::size_t serials = 0;
+    // blocks opened and closed to each level, and opened to it
+    std::vector<std::size_t> reached;
+    std::vector<std::size_t> opened;
+    std::map<std::string, Name> names;
+    std::map<std::string, Label> labels;
+
+    bool failed = false;
+    std::map<int, std::string> syntaxErrors;
+    std::vector<std::string> typeErrors;
+    std::size_t statements = 0;
+    std::size_t maxDepth = 0;
+};
+} // k_13
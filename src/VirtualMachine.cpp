@@ -0,0 +1,284 @@
+#include "VirtualMachine.hpp"
+
+#include <charconv>
+#include <cstdint>
+
+#if defined(__GNUC__)
+#define K13_THREADED 1
+#else
+#define K13_THREADED 0
+#endif
+
+namespace {
+    // int arithmetic of the generated code, wrapping instead of overflowing
+    inline std::int64_t wrap(std::int64_t value) {
+        return static_cast<std::int32_t>(static_cast<std::uint32_t>(value));
+    }
+
+    void appendInt(std::string &s, std::int64_t value) {
+        char buffer[12];
+        s.append(buffer, std::to_chars(buffer, buffer + sizeof(buffer), static_cast<int>(value)).ptr - buffer);
+    }
+}
+
+int k_13::VirtualMachine::run(const BytecodeProgram &program) {
+    r.assign(program.intRegisters, 0);
+    s.assign(program.stringRegisters, std::string());
+    const std::vector<std::string> &literals = program.literals;
+    output.clear();
+    stoppedAt = -1;
+    int status = 0;
+    std::uint64_t statements = 0;
+    std::uint64_t nextPoll = firstPoll;
+    auto text = [this, &literals](int operand) -> const std::string & {
+        return operand < 0 ? literals[-operand - 1] : s[operand];
+    };
+
+#if K13_THREADED
+    // same order as Opcode
+    static const void *const handlers[] = {
+        &&op_HALT, &&op_LOAD_INT, &&op_LOAD_LITERAL, &&op_MOVE,
+        &&op_ADD, &&op_SUB, &&op_MUL, &&op_DIV, &&op_MOD,
+        &&op_EQUAL, &&op_NEQUAL, &&op_LESS, &&op_GREATER,
+        &&op_STR_EQUAL, &&op_STR_NEQUAL, &&op_STR_LESS, &&op_STR_GREATER,
+        &&op_NOT, &&op_TO_BOOL, &&op_TO_INT16,
+        &&op_JUMP, &&op_JUMP_ZERO, &&op_JUMP_NOT_ZERO, &&op_JUMP_NOT_LESS, &&op_INCREMENT16,
+        &&op_STR_CLEAR, &&op_STR_APPEND, &&op_STR_APPEND_LITERAL, &&op_STR_APPEND_INT,
+        &&op_STR_APPEND_BOOL, &&op_STR_APPEND_CSTR, &&op_STR_SWAP,
+        &&op_PUT, &&op_GET_INT16, &&op_GET_BOOL, &&op_GET_STRING,
+        &&op_SAFE_POINT,
+    };
+    static_assert(sizeof(handlers) / sizeof(handlers[0]) == static_cast<std::size_t>(Opcode::COUNT));
+    std::vector<Threaded> code(program.code.size());
+    for (std::size_t i = 0; i < code.size(); i++) {
+        const Instruction &instruction = program.code[i];
+        code[i] = {handlers[static_cast<int>(instruction.op)], instruction.a, instruction.b, instruction.c};
+    }
+    const Threaded *ip = code.data();
+#define K13_NEXT() goto *(++ip)->handler
+#define K13_JUMP(target) do { ip = code.data() + (target); goto *ip->handler; } while (0)
+    goto *ip->handler;
+#else
+    const std::vector<Instruction> &code = program.code;
+    const Instruction *ip = code.data();
+#define K13_NEXT() do { ++ip; goto dispatch; } while (0)
+#define K13_JUMP(target) do { ip = code.data() + (target); goto dispatch; } while (0)
+dispatch:
+    switch (ip->op) {
+    case Opcode::HALT: goto op_HALT;
+    case Opcode::LOAD_INT: goto op_LOAD_INT;
+    case Opcode::LOAD_LITERAL: goto op_LOAD_LITERAL;
+    case Opcode::MOVE: goto op_MOVE;
+    case Opcode::ADD: goto op_ADD;
+    case Opcode::SUB: goto op_SUB;
+    case Opcode::MUL: goto op_MUL;
+    case Opcode::DIV: goto op_DIV;
+    case Opcode::MOD: goto op_MOD;
+    case Opcode::EQUAL: goto op_EQUAL;
+    case Opcode::NEQUAL: goto op_NEQUAL;
+    case Opcode::LESS: goto op_LESS;
+    case Opcode::GREATER: goto op_GREATER;
+    case Opcode::STR_EQUAL: goto op_STR_EQUAL;
+    case Opcode::STR_NEQUAL: goto op_STR_NEQUAL;
+    case Opcode::STR_LESS: goto op_STR_LESS;
+    case Opcode::STR_GREATER: goto op_STR_GREATER;
+    case Opcode::NOT: goto op_NOT;
+    case Opcode::TO_BOOL: goto op_TO_BOOL;
+    case Opcode::TO_INT16: goto op_TO_INT16;
+    case Opcode::JUMP: goto op_JUMP;
+    case Opcode::JUMP_ZERO: goto op_JUMP_ZERO;
+    case Opcode::JUMP_NOT_ZERO: goto op_JUMP_NOT_ZERO;
+    case Opcode::JUMP_NOT_LESS: goto op_JUMP_NOT_LESS;
+    case Opcode::INCREMENT16: goto op_INCREMENT16;
+    case Opcode::STR_CLEAR: goto op_STR_CLEAR;
+    case Opcode::STR_APPEND: goto op_STR_APPEND;
+    case Opcode::STR_APPEND_LITERAL: goto op_STR_APPEND_LITERAL;
+    case Opcode::STR_APPEND_INT: goto op_STR_APPEND_INT;
+    case Opcode::STR_APPEND_BOOL: goto op_STR_APPEND_BOOL;
+    case Opcode::STR_APPEND_CSTR: goto op_STR_APPEND_CSTR;
+    case Opcode::STR_SWAP: goto op_STR_SWAP;
+    case Opcode::PUT: goto op_PUT;
+    case Opcode::GET_INT16: goto op_GET_INT16;
+    case Opcode::GET_BOOL: goto op_GET_BOOL;
+    case Opcode::GET_STRING: goto op_GET_STRING;
+    case Opcode::SAFE_POINT: goto op_SAFE_POINT;
+    default: goto op_HALT;
+    }
+#endif
+
+op_LOAD_INT:
+    r[ip->a] = ip->b;
+    K13_NEXT();
+op_LOAD_LITERAL:
+    r[ip->a] = reinterpret_cast<std::intptr_t>(literals[ip->b].c_str());
+    K13_NEXT();
+op_MOVE:
+    r[ip->a] = r[ip->b];
+    K13_NEXT();
+op_ADD:
+    r[ip->a] = wrap(r[ip->b] + r[ip->c]);
+    K13_NEXT();
+op_SUB:
+    r[ip->a] = wrap(r[ip->b] - r[ip->c]);
+    K13_NEXT();
+op_MUL:
+    r[ip->a] = wrap(r[ip->b] * r[ip->c]);
+    K13_NEXT();
+op_DIV:
+    if (r[ip->c] == 0)
+        goto divisionByZero;
+    r[ip->a] = wrap(r[ip->b] / r[ip->c]);
+    K13_NEXT();
+op_MOD:
+    if (r[ip->c] == 0)
+        goto divisionByZero;
+    r[ip->a] = wrap(r[ip->b] % r[ip->c]);
+    K13_NEXT();
+op_EQUAL:
+    r[ip->a] = r[ip->b] == r[ip->c];
+    K13_NEXT();
+op_NEQUAL:
+    r[ip->a] = r[ip->b] != r[ip->c];
+    K13_NEXT();
+op_LESS:
+    r[ip->a] = r[ip->b] < r[ip->c];
+    K13_NEXT();
+op_GREATER:
+    r[ip->a] = r[ip->b] > r[ip->c];
+    K13_NEXT();
+op_STR_EQUAL:
+    r[ip->a] = text(ip->b) == text(ip->c);
+    K13_NEXT();
+op_STR_NEQUAL:
+    r[ip->a] = text(ip->b) != text(ip->c);
+    K13_NEXT();
+op_STR_LESS:
+    r[ip->a] = text(ip->b) < text(ip->c);
+    K13_NEXT();
+op_STR_GREATER:
+    r[ip->a] = text(ip->b) > text(ip->c);
+    K13_NEXT();
+op_NOT:
+    r[ip->a] = !r[ip->b];
+    K13_NEXT();
+op_TO_BOOL:
+    r[ip->a] = r[ip->b] != 0;
+    K13_NEXT();
+op_TO_INT16:
+    r[ip->a] = static_cast<std::int16_t>(r[ip->b]);
+    K13_NEXT();
+op_JUMP:
+    K13_JUMP(ip->a);
+op_JUMP_ZERO:
+    if (!r[ip->a])
+        K13_JUMP(ip->b);
+    K13_NEXT();
+op_JUMP_NOT_ZERO:
+    if (r[ip->a])
+        K13_JUMP(ip->b);
+    K13_NEXT();
+op_JUMP_NOT_LESS:
+    if (r[ip->a] >= r[ip->b])
+        K13_JUMP(ip->c);
+    K13_NEXT();
+op_INCREMENT16:
+    r[ip->a] = static_cast<std::int16_t>(r[ip->a] + 1);
+    K13_NEXT();
+op_STR_CLEAR:
+    s[ip->a].clear();
+    K13_NEXT();
+op_STR_APPEND:
+    s[ip->a].append(s[ip->b]);
+    K13_NEXT();
+op_STR_APPEND_LITERAL:
+    s[ip->a].append(literals[ip->b]);
+    K13_NEXT();
+op_STR_APPEND_INT:
+    appendInt(s[ip->a], r[ip->b]);
+    K13_NEXT();
+op_STR_APPEND_BOOL:
+    s[ip->a].push_back(r[ip->b] ? '1' : '0');
+    K13_NEXT();
+op_STR_APPEND_CSTR:
+    s[ip->a].append(reinterpret_cast<const char *>(r[ip->b]));
+    K13_NEXT();
+op_STR_SWAP:
+    s[ip->a].swap(s[ip->b]);
+    K13_NEXT();
+op_PUT:
+    output.append(s[ip->a]);
+    output.push_back('\n');
+    if (output.size() >= (1 << 16))
+        flush();
+    if (program.interactive) {
+        flush();
+        out.flush();
+    }
+    K13_NEXT();
+op_GET_INT16: {
+    std::int16_t value = static_cast<std::int16_t>(r[ip->a]);
+    in >> value;
+    r[ip->a] = value;
+    K13_NEXT();
+}
+op_GET_BOOL: {
+    bool value = r[ip->a] != 0;
+    in >> value;
+    r[ip->a] = value;
+    K13_NEXT();
+}
+op_GET_STRING:
+    in >> s[ip->a];
+    K13_NEXT();
+op_SAFE_POINT:
+    statements += static_cast<std::uint64_t>(ip->b);
+    if (statements >= nextPoll && onSafePoint) {
+        nextPoll = statements + pollInterval;
+        if (onSafePoint(statements)) {
+            stoppedAt = ip->a;
+            status = 1;
+            goto op_HALT;
+        }
+    }
+    K13_NEXT();
+
+divisionByZero:
+    std::cerr << "[ERROR] Division by zero at line " << program.lines[ip - code.data()] << std::endl;
+    status = -1;
+op_HALT:
+#undef K13_NEXT
+#undef K13_JUMP
+    flush();
+    out.flush();
+    return status;
+}
+
+void k_13::VirtualMachine::flush() {
+    out.write(output.data(), static_cast<std::streamsize>(output.size()));
+    output.clear();
+}
+
+void k_13::VirtualMachine::writeState(std::ostream &state, const BytecodeProgram &program) {
+    auto bytes = [&state](const char *data, std::size_t size) {
+        state << size << '\n';
+        state.write(data, static_cast<std::streamsize>(size));
+        state << '\n';
+    };
+    state << (stoppedAt < 0 ? std::string() : program.safePoints[stoppedAt]) << '\n';
+    for (auto &[name, reg] : program.registers) {
+        if (program.types.at(name) == LexemType::STRING)
+            bytes(s[reg].data(), s[reg].size());
+        else
+            state << r[reg] << '\n';
+    }
+    state << (in.fail() ? 1 : 0) << '\n';
+    std::string pending;
+    if (std::streambuf *buffer = in.rdbuf()) {
+        std::streamsize available = buffer->in_avail();
+        if (available > 0) {
+            pending.resize(static_cast<std::size_t>(available));
+            pending.resize(static_cast<std::size_t>(buffer->sgetn(pending.data(), available)));
+        }
+    }
+    bytes(pending.data(), pending.size());
+}
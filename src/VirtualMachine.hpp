@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <iostream>
+#include <functional>
+
+#include "Bytecode.hpp"
+
+namespace k_13 {
+// Interpreter for BytecodeProgram. With GCC and Clang every instruction
+// jumps straight to the handler of the next one (direct threading through
+// computed goto), other compilers dispatch through a switch.
+class VirtualMachine {
+public:
+    VirtualMachine(std::istream &in_, std::ostream &out_) : in(in_), out(out_) {}
+    ~VirtualMachine() = default;
+
+    // 0 when the program reaches its end, -1 on a runtime error, 1 when the
+    // safe point handler stopped it
+    int run(const BytecodeProgram &program);
+    // called with the statements run so far at the first safe point after
+    // first statements, then about every pollInterval statements. Returning
+    // true stops the run there.
+    void setSafePointHandler(std::function<bool(std::uint64_t)> handler, std::uint64_t first = pollInterval) {
+        onSafePoint = std::move(handler);
+        firstPoll = first;
+    }
+    // label of the safe point, variables in the order of their names, the
+    // failure flag of the input and the input read but not consumed yet
+    void writeState(std::ostream &state, const BytecodeProgram &program);
+
+private:
+    // instruction with its opcode replaced by the address of its handler
+    struct Threaded {
+        const void *handler = nullptr;
+        int a = 0;
+        int b = 0;
+        int c = 0;
+    };
+
+    void flush();
+
+    static constexpr std::uint64_t pollInterval = 1 << 16;
+
+    std::istream &in;
+    std::ostream &out;
+    std::vector<std::int64_t> r;
+    std::vector<std::string> s;
+    std::function<bool(std::uint64_t)> onSafePoint;
+    std::uint64_t firstPoll = pollInterval;
+    // safe point the last run stopped at
+    int stoppedAt = -1;
+    // put collects the output and writes it in large blocks
+    std::string output;
+};
+
+} // k_13
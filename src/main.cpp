@@ -1,92 +1,385 @@
 #include <iostream>
 #include <cstdlib>
 #include <filesystem>
+#include <fstream>
+#include <thread>
+#include <sstream>
+#include <functional>
+#include <chrono>
+#include <list>
+#include <algorithm>
+#include <charconv>
+#include <limits>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
 
 #include "LexicalAnalyzer.hpp"
 #include "SyntaxAnalyzer.hpp"
 #include "SemanticAnalyzer.hpp"
+#include "Optimizer.hpp"
 #include "Generator.hpp"
+#include "CGenerator.hpp"
+#include "AsmGenerator.hpp"
+#include "Bytecode.hpp"
+#include "VirtualMachine.hpp"
+#include "Jit.hpp"
+#include "Process.hpp"
+#include "Sha256.hpp"
+#include "BuildCache.hpp"
+#include "FrontEndCache.hpp"
+#include "StreamCompiler.hpp"
+#include "Dump.hpp"
 
-void writeLexems(const std::vector<k_13::Lexem>& lexems, const std::vector<k_13::Literal>& literals,
-    const std::vector<k_13::UnknownLexem>& unknownLexems, const std::string& outDir);
-void writeIdentifierTable(const std::map<std::string, std::vector<std::pair<int, k_13::ExpressionType>>>& identifiers, const std::string& outDir);
-void writeLabelTable(const std::map<std::string, std::list<std::pair<int, k_13::ExpressionType>>>& labels, const std::string& outDir);
-void writeVariableTable(const std::map<std::string, k_13::LexemType>& variableTable, const std::string& outDir);
-void writeExpressions(const std::list<std::pair<k_13::LexemType, std::vector<k_13::Lexem>>>& expressions, const std::string& outDir);
+void closeDump(k_13::Dump& dump);
+void reportOutput(const std::string& what, std::size_t bytes, std::chrono::steady_clock::duration elapsed);
 void writeKeywords(const std::vector<k_13::Keyword>& keywords, const std::string& outDir);
 
-std::string findDistance(const int maxSize, const std::string& lexems);
-bool isGppInstalled();
+int finish(k_13::Process& process);
+bool hasCppRuntime();
+int buildCpp(const std::string& progName, const std::string& outDir, const std::string& dataStub, bool runtime,
+    const std::vector<std::string>& units = {});
+int linkCpp(k_13::Process& object, const std::string& progName, const std::string& outDir, const std::string& dataStub, bool runtime,
+    const std::vector<std::string>& units = {});
+int pipeCpp(k_13::Generator& generator, const std::function<int(std::ostream&)>& generate,
+    const std::string& progName, const std::string& outDir, int& buildStatus);
+int cachedCpp(k_13::Generator& generator, const std::vector<k_13::Keyword>& keywords, const std::vector<k_13::Literal>& literals,
+    const std::string& progName, const std::string& outDir, k_13::BuildCache& cache, bool pipe);
+void buildC(const std::string& progName, const std::string& outDir);
+void buildAsm(const std::string& progName, const std::string& outDir);
+int runBytecode(const std::vector<k_13::Keyword>& keywords, const std::vector<k_13::Literal>& literals, const k_13::GeneratorOptions& options, bool jit);
+int runTiered(const std::vector<k_13::Keyword>& keywords, const std::vector<k_13::Literal>& literals, const k_13::GeneratorOptions& options,
+    const std::string& progName, const std::string& outDir, std::uint64_t threshold);
+
+// the decimal value of an option, false when it isn't a number or is larger than max
+template <typename T>
+bool parseNumber(const std::string& value, T& number, T max = std::numeric_limits<T>::max()) {
+    T parsed = 0;
+    auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), parsed);
+    if (value.empty() || error != std::errc() || end != value.data() + value.size() || parsed > max)
+        return false;
+    number = parsed;
+    return true;
+}
 
 int main(int argc, char* argv[]) {
-    if (argc < 2) {
+    std::vector<std::string> arguments;
+    bool optimize = true;
+    k_13::GeneratorOptions generatorOptions;
+    std::string target = "cpp";
+    bool run = false;
+    bool jit = false;
+    bool tiered = false;
+    bool pipe = false;
+    bool stream = false;
+    std::filesystem::path cacheDirectory;
+    std::uintmax_t cacheSize = 512;
+    std::uint64_t tierThreshold = 1000000;
+    k_13::DumpOptions dumpOptions;
+    generatorOptions.runtimeLibrary = hasCppRuntime();
+    generatorOptions.threads = std::max(1u, std::thread::hardware_concurrency());
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-O0") {
+            optimize = false;
+        }
+        else if (arg == "-O1") {
+            optimize = true;
+        }
+        else if (arg == "--no-hoist-declarations") {
+            generatorOptions.hoistDeclarations = false;
+        }
+        else if (arg == "--target=cpp" || arg == "--target=c") {
+            target = arg.substr(std::string("--target=").size());
+        }
+        else if (arg == "--target=asm") {
+#if defined(__linux__) && defined(__x86_64__)
+            target = "asm";
+#else
+            std::cerr << "Error: --target=asm is only supported on x86-64 Linux" << std::endl;
+            return -1;
+#endif
+        }
+        else if (arg == "--run") {
+            run = true;
+        }
+        else if (arg == "--jit") {
+            if (!k_13::Jit::isSupported()) {
+                std::cerr << "Error: --jit is only supported on x86-64 Linux" << std::endl;
+                return -1;
+            }
+            run = true;
+            jit = true;
+        }
+        else if (arg == "--tiered") {
+#ifdef _WIN32
+            std::cerr << "Error: --tiered is only supported on POSIX systems" << std::endl;
+            return -1;
+#else
+            run = true;
+            tiered = true;
+#endif
+        }
+        else if (arg.rfind("--tier-threshold=", 0) == 0) {
+            if (!parseNumber(arg.substr(std::string("--tier-threshold=").size()), tierThreshold)) {
+                std::cerr << "Error: --tier-threshold expects a number of statements" << std::endl;
+                return -1;
+            }
+        }
+        else if (arg == "--pipe") {
+#ifdef _WIN32
+            std::cerr << "Error: --pipe is only supported on POSIX systems" << std::endl;
+            return -1;
+#else
+            pipe = true;
+#endif
+        }
+        else if (arg == "--cache") {
+            cacheDirectory = k_13::BuildCache::defaultDirectory();
+        }
+        else if (arg.rfind("--cache=", 0) == 0 && arg.size() > std::string("--cache=").size()) {
+            cacheDirectory = arg.substr(std::string("--cache=").size());
+        }
+        else if (arg.rfind("--cache-size=", 0) == 0) {
+            // the size is turned into bytes, which must still fit
+            if (!parseNumber(arg.substr(std::string("--cache-size=").size()), cacheSize, std::numeric_limits<std::uintmax_t>::max() >> 20)) {
+                std::cerr << "Error: --cache-size expects a number of MiB" << std::endl;
+                return -1;
+            }
+        }
+        else if (arg == "--split") {
+            generatorOptions.partitionStatements = 1000;
+        }
+        else if (arg.rfind("--split=", 0) == 0) {
+            if (!parseNumber(arg.substr(std::string("--split=").size()), generatorOptions.partitionStatements)) {
+                std::cerr << "Error: --split expects a number of statements" << std::endl;
+                return -1;
+            }
+        }
+        else if (arg == "--stream") {
+            stream = true;
+        }
+        else if (arg.rfind("--codegen-threads=", 0) == 0) {
+            unsigned threads = 0;
+            if (!parseNumber(arg.substr(std::string("--codegen-threads=").size()), threads) || threads == 0) {
+                std::cerr << "Error: --codegen-threads expects a number of threads" << std::endl;
+                return -1;
+            }
+            generatorOptions.threads = threads;
+        }
+        else if (arg == "--standalone") {
+            generatorOptions.runtimeLibrary = false;
+        }
+        else if (arg == "--interactive") {
+            generatorOptions.interactive = true;
+        }
+        else if (arg.rfind("--blob-threshold=", 0) == 0) {
+            if (!parseNumber(arg.substr(std::string("--blob-threshold=").size()), generatorOptions.blobThreshold)) {
+                std::cerr << "Error: --blob-threshold expects a number of bytes" << std::endl;
+                return -1;
+            }
+        }
+        else if (arg.rfind("--dump=", 0) == 0) {
+            if (!k_13::Dump::select(arg.substr(std::string("--dump=").size()), dumpOptions)) {
+                std::cerr << "Error: --dump expects a list of tokens, literals, unknown, identifiers, labels, variables, expressions, symbols or all" << std::endl;
+                return -1;
+            }
+        }
+        else if (arg == "--dump-format=jsonl" || arg == "--dump-format=text") {
+            dumpOptions.text = arg == "--dump-format=text";
+        }
+        else if (arg.size() > 1 && arg[0] == '-') {
+            std::cerr << "Error: unknown option " << arg << std::endl;
+            return -1;
+        }
+        else {
+            arguments.push_back(arg);
+        }
+    }
+    if (arguments.empty()) {
         std::cerr << "Error: input path to file for compilation" << std::endl;
         return -1;
     }
+    // a split program is several files, it is built from the output directory
+    bool split = generatorOptions.partitionStatements > 0;
+    if (split && (pipe || !cacheDirectory.empty()))
+        std::cerr << "[WARN] --split builds the translation units from files, --pipe and the build cache are not used" << std::endl;
+    // a streamed program is never held, it can't be run, optimized, split or cached
+    if (stream && (run || target != "cpp")) {
+        std::cerr << "Error: --stream only compiles to C++, it can't be combined with --run or --target=" << target << std::endl;
+        return -1;
+    }
+    if (stream && (split || pipe || !cacheDirectory.empty()))
+        std::cerr << "[WARN] --stream writes the program as one file, --split, --pipe and the build cache are not used" << std::endl;
+    if (stream && dumpOptions.any())
+        std::cerr << "[WARN] --stream keeps no tables, --dump is not used" << std::endl;
     std::string outDir;
-    if (argc == 3) {
-        outDir = argv[2];
+    if (arguments.size() == 2) {
+        outDir = arguments[1];
     }
     else {
-        std::filesystem::path arg1 = argv[1];
+        std::filesystem::path arg1 = arguments[0];
         outDir = (arg1.parent_path() / "build").string();
     }
-    std::string path = argv[1];
+    std::string path = arguments[0];
+    if (stream) {
+        std::error_code error;
+        std::filesystem::create_directories(outDir, error);
+        k_13::StreamCompiler compiler;
+        compiler.setOptions(generatorOptions);
+        switch (compiler.compile(path, outDir)) {
+        case 0:
+            std::cout << "[INFO] Streamed " << compiler.getStatements() << " statements, blocks nested at most "
+                << compiler.getMaxDepth() << " deep, " << compiler.getEmitted() << " bytes of C++" << std::endl;
+            buildCpp(compiler.getProgramName(), outDir, "", generatorOptions.runtimeLibrary);
+            break;
+        case -1:
+            std::cout << "[ERROR] Errors found. Build failed" << std::endl;
+            break;
+        default:
+            std::cout << "[ERROR] Can't reach file with path: " << path << std::endl;
+            break;
+        }
+        return 0;
+    }
+    // with --run stdout belongs to the program, the compiler reports to stderr
+    std::streambuf *coutBuffer = std::cout.rdbuf();
+    if (run)
+        std::cout.rdbuf(std::cerr.rdbuf());
     k_13::LexicalAnalyzer lexic;
     k_13::SyntaxAnalyzer syntax;
     k_13::SemanticAnalyzer semantic;
+    k_13::Optimizer optimizer;
     k_13::Generator generator;
+    generator.setOptions(generatorOptions);
+    k_13::CGenerator cGenerator;
+    cGenerator.setOptions(generatorOptions);
+    k_13::AsmGenerator asmGenerator;
+    asmGenerator.setOptions(generatorOptions);
+    std::vector<k_13::Keyword> keywords;
 
-    std::string objGenCom = "g++ -c ";
-    std::filesystem::path cppPath = outDir;
-    std::filesystem::path objPath = outDir;
-    std::filesystem::path exePath = outDir;
-    std::string exeGenCom = "g++ ";
+    // the front end of a source seen before is loaded instead of analyzed again
+    k_13::FrontEnd frontEnd;
+    // tables are only written when --dump asks for them
+    k_13::Dump dump;
+    std::string self = std::filesystem::exists("/proc/self/exe") ? "/proc/self/exe" : argv[0];
+    k_13::FrontEndCache frontEndCache(cacheDirectory / "frontend", k_13::BuildCache::toolIdentity(self));
+    std::string frontEndKey;
+    bool cached = false;
+    if (!cacheDirectory.empty() && std::filesystem::path(path).extension() == ".k13") {
+        std::ifstream source(path, std::ios::binary);
+        if (source.is_open()) {
+            auto begin = std::chrono::steady_clock::now();
+            std::error_code error;
+            std::string text(static_cast<std::size_t>(std::filesystem::file_size(path, error)), '\0');
+            source.read(text.data(), static_cast<std::streamsize>(text.size()));
+            frontEndKey = frontEndCache.key(text);
+            cached = frontEndCache.load(frontEndKey, frontEnd);
+            auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin);
+            if (cached)
+                std::cout << "[INFO] Front end loaded from cache " << frontEndKey.substr(0, 16) << " in " << elapsed.count() << " us" << std::endl;
+        }
+    }
 
-    int lexicalAnalysStatus = lexic.readFromFile(path);
+    int lexicalAnalysStatus = cached ? 0 : lexic.readFromFile(path);
     int syntaxAnalysStatus;
     int semanticAnalysStatus;
     int generatorStatus;
     switch (lexicalAnalysStatus) {
     case 0:
-        std::cout << "[INFO] Done\n";
-        writeLexems(lexic.getLexems(), lexic.getLiterals(), lexic.getUnknownLexems(), outDir);
-        syntaxAnalysStatus = syntax.analyze(lexic.getLexems(), lexic.getUnknownLexems());
+        if (!cached) {
+            std::cout << "[INFO] Done\n";
+            frontEnd.lexems = lexic.getLexems();
+            frontEnd.literals = lexic.getLiterals();
+            frontEnd.unknownLexems = lexic.getUnknownLexems();
+        }
+        if (!std::filesystem::create_directory(outDir)) {
+            std::cout << "[WARN] Directory exists. Make sure it's empty" << std::endl;
+        }
+        if (dump.open(dumpOptions, outDir) != 0)
+            std::cout << "[WARN] Can't create " << dump.getPath().string() << ", no tables are dumped" << std::endl;
+        dump.lexical(frontEnd);
+        syntaxAnalysStatus = cached ? 0 : syntax.analyze(frontEnd.lexems, frontEnd.unknownLexems);
+        if (syntaxAnalysStatus != 0)
+            closeDump(dump);
         switch (syntaxAnalysStatus) {
         case 0:
-            std::cout << "[INFO] Syntax analysis done" << std::endl;
-            writeIdentifierTable(syntax.getIdentifiers(), outDir);
-            writeLabelTable(syntax.getLabels(), outDir);
-            writeVariableTable(syntax.getVariableTable(), outDir);
-            writeExpressions(syntax.getExpressions(), outDir);
+            if (!cached) {
+                std::cout << "[INFO] Syntax analysis done" << std::endl;
+                frontEnd.programName = syntax.getProgramName();
+                frontEnd.identifiers = syntax.getIdentifiers();
+                frontEnd.labels = syntax.getLabels();
+                frontEnd.variableTable = syntax.getVariableTable();
+                frontEnd.expressions = syntax.getExpressions();
+                frontEnd.keywords = syntax.getKeywords();
+            }
+            dump.syntax(frontEnd);
+            closeDump(dump);
 
-            semanticAnalysStatus = semantic.analyze(syntax.getIdentifiers(), syntax.getLabels(), syntax.getVariableTable(), syntax.getExpressions());
+            semanticAnalysStatus = cached ? 0 : semantic.analyze(frontEnd.identifiers, frontEnd.labels, frontEnd.variableTable, frontEnd.expressions);
             switch (semanticAnalysStatus) {
             case 0:
-                std::cout << "[INFO] Semantic analysis done" << std::endl;
-                generatorStatus = generator.createCpp(syntax.getKeywords(), syntax.getProgramName(), outDir, lexic.getLiterals());
+                if (!cached) {
+                    std::cout << "[INFO] Semantic analysis done" << std::endl;
+                    if (!frontEndKey.empty() && frontEndCache.store(frontEndKey, frontEnd) != 0)
+                        std::cout << "[WARN] Can't store the front end in the cache" << std::endl;
+                    else if (!frontEndKey.empty())
+                        k_13::BuildCache(cacheDirectory, cacheSize << 20).evict();
+                }
+                keywords = frontEnd.keywords;
+                if (optimize) {
+                    optimizer.eliminateDeadCode(keywords);
+                    std::cout << "[INFO] Dead code elimination removed " << optimizer.getRemovedStatements() << " statements, "
+                        << optimizer.getRemovedDeclarations() << " declarations" << std::endl;
+                    optimizer.eliminateCommonSubexpressions(keywords);
+                    std::cout << "[INFO] Common subexpression elimination introduced " << optimizer.getTemporaries() << " temporaries for "
+                        << optimizer.getReplacedExpressions() << " expressions" << std::endl;
+                    optimizer.hoistLoopInvariants(keywords);
+                    std::cout << "[INFO] Loop-invariant code motion hoisted " << optimizer.getHoistedExpressions() << " expressions out of loops" << std::endl;
+                    optimizer.boundStringLengths(keywords, frontEnd.literals);
+                    generator.setStringBounds(optimizer.getStringBounds());
+                    std::cout << "[INFO] Length analysis bounded " << optimizer.getStringBounds().size() << " of "
+                        << optimizer.getStringVariables() << " strings" << std::endl;
+                }
+                if (run) {
+                    std::cout.rdbuf(coutBuffer);
+                    if (tiered && !jit)
+                        return runTiered(keywords, frontEnd.literals, generatorOptions, frontEnd.programName, outDir, tierThreshold);
+                    return runBytecode(keywords, frontEnd.literals, generatorOptions, jit);
+                }
+                if (target == "c")
+                    generatorStatus = cGenerator.createC(keywords, frontEnd.programName, outDir, frontEnd.literals);
+                else if (target == "asm")
+                    generatorStatus = asmGenerator.createAsm(keywords, frontEnd.programName, outDir, frontEnd.literals);
+                else if (!cacheDirectory.empty() && !split && !k_13::Process::find("g++").empty()) {
+                    k_13::BuildCache cache(cacheDirectory, cacheSize << 20);
+                    generatorStatus = cachedCpp(generator, keywords, frontEnd.literals, frontEnd.programName, outDir, cache, pipe);
+                }
+                else if (pipe && !split && !k_13::Process::find("g++").empty()) {
+                    int buildStatus;
+                    generatorStatus = pipeCpp(generator, [&](std::ostream& file) {
+                        return generator.streamCpp(keywords, frontEnd.programName, outDir, frontEnd.literals, file);
+                    }, frontEnd.programName, outDir, buildStatus);
+                }
+                else {
+                    auto begin = std::chrono::steady_clock::now();
+                    generatorStatus = generator.createCpp(keywords, frontEnd.programName, outDir, frontEnd.literals);
+                    if (generatorStatus == 0)
+                        reportOutput("Emitted C++", generator.getEmitted(), std::chrono::steady_clock::now() - begin);
+                }
                 switch (generatorStatus) {
                 case 0:
-                    cppPath /= syntax.getProgramName() + ".cpp";
-                    std::cout << "[INFO] Generation completed to " << cppPath.string() << std::endl;
-                    if (isGppInstalled()) {
-                        objPath /= syntax.getProgramName();
-                        exePath /= syntax.getProgramName();
-                        objGenCom += cppPath.string() + " -o " + objPath.string();
-                        exeGenCom += cppPath.string() + " -o " + exePath.string();
-#ifdef _WIN32
-                        objGenCom += ".obj";
-                        exeGenCom += ".exe";
-#else
-                        objGenCom += ".o";
-#endif
-                        std::system(exeGenCom.c_str());
-                        std::system(objGenCom.c_str());
-                        std::cout << "[INFO] G++ finish" << std::endl;
+                    if (target == "c") {
+                        buildC(frontEnd.programName, outDir);
+                        break;
                     }
-                    else {
-                        std::cout << "[WARN] g++ (gcc) isn't installed in your system. To generate executive file use any c++ compiler or install g++ and rerun k13 compiler" << std::endl;
+                    if (target == "asm") {
+                        buildAsm(frontEnd.programName, outDir);
+                        break;
                     }
+                    // a piped or cached build is done by now
+                    if ((!pipe && cacheDirectory.empty()) || split || k_13::Process::find("g++").empty())
+                        buildCpp(frontEnd.programName, outDir, generator.getDataStub(), generatorOptions.runtimeLibrary, generator.getUnits());
                     break;
                 case -1:
                     std::cout << "[ERROR] Generator error. Can't create file" << std::endl;
@@ -118,154 +411,403 @@ int main(int argc, char* argv[]) {
     default:
         break;
     }
-    return 0;
+    std::cout.rdbuf(coutBuffer);
+    return run ? -1 : 0;
 }
 
-bool isGppInstalled() {
-    int result = std::system("g++ --version");
-    return (result == 0);
+// waits for a build step and reports its status and what it cost
+int finish(k_13::Process& process) {
+    int status = process.wait();
+    if (status != 0) {
+        std::cout << "[ERROR] " << process.command() << " failed with status " << status << std::endl;
+        return status;
+    }
+    std::cout << "[INFO] " << process.command() << " (user " << process.getUserSeconds() << " s, system "
+        << process.getSystemSeconds() << " s, max rss " << process.getMaxResident() << " KiB)" << std::endl;
+    return 0;
 }
 
-void writeLexems(const std::vector<k_13::Lexem>& lexems, const std::vector<k_13::Literal>& literals,
-    const std::vector<k_13::UnknownLexem>& unknownLexems, const std::string& outDir) {
-    k_13::constants_k13 constants;
+#ifdef _WIN32
+const std::string objExtension = ".obj";
+const std::string exeExtension = ".exe";
+#else
+const std::string objExtension = ".o";
+const std::string exeExtension = "";
+#endif
 
-    std::filesystem::path outputFile = outDir;
-    if (!std::filesystem::create_directory(outDir)) {
-        std::cout << "[WARN] Directory exists. Make sure it's empty" << std::endl;
+// the prebuilt runtime of generated C++, as long as it is where k13c was built
+bool hasCppRuntime() {
+    static const bool found = [] {
+        std::error_code error;
+        return std::filesystem::is_regular_file(K13RT_CPP_LIBRARY, error)
+            && std::filesystem::is_regular_file(std::filesystem::path(K13RT_CPP_INCLUDE_DIR) / "k13rt.hpp", error);
+    }();
+    return found;
+}
+
+int buildCpp(const std::string& progName, const std::string& outDir, const std::string& dataStub, bool runtime,
+    const std::vector<std::string>& units) {
+    std::filesystem::path cppPath = outDir;
+    std::filesystem::path objPath = outDir;
+    cppPath /= progName + ".cpp";
+    objPath /= progName;
+    std::cout << "[INFO] Generation completed to " << cppPath.string() << std::endl;
+    if (k_13::Process::find("g++").empty()) {
+        std::cout << "[WARN] g++ (gcc) isn't installed in your system. To generate executive file use any c++ compiler or install g++ and rerun k13 compiler" << std::endl;
+        return -1;
     }
-    outputFile /= "allLexems.txt";
+    std::vector<std::string> compile = {"g++", "-c", cppPath.string(), "-o", objPath.string() + objExtension};
+    // k13rt.hpp.gch next to the header is picked up instead of parsing it
+    if (runtime)
+        compile.push_back("-I" + std::string(K13RT_CPP_INCLUDE_DIR));
+    k_13::Process object(compile);
+    object.start();
+    return linkCpp(object, progName, outDir, dataStub, runtime, units);
+}
 
-    std::ofstream file(outputFile);
-    if (file.is_open()) {
-        file << "|----------------------------------------------------------------------------------------|\n";
-        file << "|                                     Lexems table                                       |\n";
-        file << "|----------------------------------------------------------------------------------------|\n";
-        file << "|   line number  |     lexem     |     value     |  lexem code  |     type of lexem      |\n";
-        file << "|----------------------------------------------------------------------------------------|\n";
-        for (auto lexem : lexems) {
-            file << "|\t" << lexem.line << findDistance(14, std::to_string(lexem.line)) << " |\t" << lexem.value << findDistance(10, lexem.value) << " |\t" << lexem.constant << "\t |\t" << static_cast<std::underlying_type_t<k_13::LexemType>>(lexem.type) << " \t|\t";
-            file << constants.enumToStringLexems[lexem.type] << findDistance(18, constants.enumToStringLexems[lexem.type]) << " |\n";
-            file << "|----------------------------------------------------------------------------------------|\n";
-        }
+// g++ compiles the code while generate writes it, no .cpp is written
+int pipeCpp(k_13::Generator& generator, const std::function<int(std::ostream&)>& generate,
+    const std::string& progName, const std::string& outDir, int& buildStatus) {
+    std::filesystem::path objPath = outDir;
+    objPath /= progName;
+    bool runtime = generator.getOptions().runtimeLibrary;
+    std::vector<std::string> compile = {"g++", "-x", "c++", "-c", "-", "-o", objPath.string() + objExtension};
+    if (runtime)
+        compile.push_back("-I" + std::string(K13RT_CPP_INCLUDE_DIR));
+    k_13::Process object(compile);
+    object.pipeInput();
+    buildStatus = -1;
+    if (object.start() != 0) {
+        std::cout << "[ERROR] Can't start " << object.command() << std::endl;
+        return -2;
+    }
+    int status = generate(object.input());
+    object.closeInput();
+    std::cout << "[INFO] Generation streamed to g++" << std::endl;
+    buildStatus = linkCpp(object, progName, outDir, generator.getDataStub(), runtime);
+    return status;
+}
 
-        file << "\n|----------------------------------------------------------------------------------------\n";
-        file << "|                          Literals table\n";
-        file << "|----------------------------------------------------------------------------------------\n";
-        file << "|   literal id   | value \n";
-        file << "|----------------------------------------------------------------------------------------\n";
-        for (auto literal : literals) {
-            file << "|\t" << literal.id << findDistance(10, std::to_string(literal.id)) << " |\t" << literal.value << " \n";
-            file << "|----------------------------------------------------------------------------------------\n";
-        }
+// the outputs are looked up by the hash of the code, the literal blob, the
+// compiler and the runtime. A hit skips g++, a miss builds as usual and stores
+// the outputs.
+int cachedCpp(k_13::Generator& generator, const std::vector<k_13::Keyword>& keywords, const std::vector<k_13::Literal>& literals,
+    const std::string& progName, const std::string& outDir, k_13::BuildCache& cache, bool pipe) {
+    std::ostringstream code;
+    if (generator.streamCpp(keywords, progName, outDir, literals, code) != 0)
+        return -1;
+    std::string source = code.str();
+    k_13::Sha256 hash;
+    hash.update("k13c cpp 1\n");
+    hash.update(k_13::BuildCache::toolIdentity(k_13::Process::find("g++")) + "\n");
+    // the object is compiled against the runtime header (or its precompiled form)
+    // and linked with the runtime library, so a rebuilt runtime misses. The
+    // standalone runtime is part of the source
+    if (generator.getOptions().runtimeLibrary) {
+        std::filesystem::path header = std::filesystem::path(K13RT_CPP_INCLUDE_DIR) / "k13rt.hpp";
+        hash.update(k_13::BuildCache::toolIdentity(header.string()) + "\n");
+        hash.update(k_13::BuildCache::toolIdentity(header.string() + ".gch") + "\n");
+        hash.update(k_13::BuildCache::toolIdentity(K13RT_CPP_LIBRARY) + "\n");
+    }
+    hash.update(std::to_string(source.size()) + "\n");
+    hash.update(source);
+    hash.update(generator.getBlob());
+    std::string key = hash.hex();
 
-        file << "\n|----------------------------------------------------------------------------------------\n";
-        file << "|                      Unknown lexems table\n";
-        file << "|----------------------------------------------------------------------------------------\n";
-        file << "|   unknown id   | value \n";
-        file << "|----------------------------------------------------------------------------------------\n";
-        for (auto unknownLexem : unknownLexems) {
-            file << "|\t" << unknownLexem.id << findDistance(10, std::to_string(unknownLexem.id)) << " |\t" << unknownLexem.value << " \n";
-            file << "|----------------------------------------------------------------------------------------\n";
+    std::filesystem::path objPath = outDir;
+    std::filesystem::path exePath = outDir;
+    objPath /= progName;
+    exePath /= progName;
+    std::vector<std::pair<std::string, std::filesystem::path>> outputs = {
+        {"program" + exeExtension, exePath.string() + exeExtension},
+        {"program" + objExtension, objPath.string() + objExtension},
+    };
+    if (!generator.getDataStub().empty())
+        outputs.push_back({"literals" + objExtension, objPath.string() + "_literals" + objExtension});
+    if (cache.fetch(key, outputs)) {
+        if (!pipe) {
+            std::ofstream file(std::filesystem::path(outDir) / (progName + ".cpp"), std::ios::binary);
+            file.write(source.data(), static_cast<std::streamsize>(source.size()));
         }
-
+        std::cout << "[INFO] Build cache hit " << key.substr(0, 16) << ", g++ skipped (" << cache.getHits() << " hits, "
+            << cache.getMisses() << " misses)" << std::endl;
+        return 0;
+    }
+    std::cout << "[INFO] Build cache miss " << key.substr(0, 16) << " (" << cache.getHits() << " hits, "
+        << cache.getMisses() << " misses)" << std::endl;
+    // outputs of an earlier hit are links into the cache, the compiler must not write through them
+    std::error_code error;
+    for (auto &output : outputs)
+        std::filesystem::remove(output.second, error);
+    int buildStatus;
+    if (pipe) {
+        if (pipeCpp(generator, [&source](std::ostream& file) {
+                file.write(source.data(), static_cast<std::streamsize>(source.size()));
+                file.flush();
+                return file ? 0 : -1;
+            }, progName, outDir, buildStatus) != 0)
+            return -1;
+    }
+    else {
+        std::ofstream file(std::filesystem::path(outDir) / (progName + ".cpp"), std::ios::binary);
+        file.write(source.data(), static_cast<std::streamsize>(source.size()));
         file.close();
+        if (!file)
+            return -1;
+        buildStatus = buildCpp(progName, outDir, generator.getDataStub(), generator.getOptions().runtimeLibrary);
+    }
+    if (buildStatus == 0) {
+        if (cache.insert(key, outputs) == 0)
+            std::cout << "[INFO] Build cache stored " << key.substr(0, 16) << " (" << (cache.getSize() >> 10) << " KiB in cache, "
+                << cache.getEvicted() << " entries evicted)" << std::endl;
+        else
+            std::cout << "[WARN] Can't store the build in the cache" << std::endl;
     }
+    return 0;
 }
 
-void writeIdentifierTable(const std::map<std::string, std::vector<std::pair<int, k_13::ExpressionType>>> &identifiers, const std::string& outDir) {
-    k_13::constants_k13 constants;
-    std::filesystem::path outputFile = outDir;
-    outputFile /= "allLexems.txt";
-    std::ofstream file(outputFile, std::ios::app);
-    if (file.is_open()) {
-        file << "|----------------------------------------------------------------------------------------|\n";
-        file << "|                                 Identifiers usage                                      |\n";
-        file << "|----------------------------------------------------------------------------------------|\n";
-        file << "|   identifier   |   line number   |   expression type   |\n";
-        file << "|----------------------------------------------------------------------------------------|\n";
-        for (auto identifier : identifiers) {
-            for (auto line : identifier.second) {
-                file << "|\t" << identifier.first << findDistance(14, identifier.first) << " |\t" << line.first << findDistance(14, std::to_string(line.first)) << " |\t" << static_cast<std::underlying_type_t<k_13::ExpressionType>>(line.second) << " \t|\t";
-                file << constants.enumToStringExpressions[line.second] << findDistance(18, constants.enumToStringExpressions[line.second]) << " |\n";
-                file << "|----------------------------------------------------------------------------------------|\n";
-            }
+// object compiles the translation unit. The blob stub and the other units of a
+// split program are compiled next to it and the executable is linked from all
+// objects.
+int linkCpp(k_13::Process& object, const std::string& progName, const std::string& outDir, const std::string& dataStub, bool runtime,
+    const std::vector<std::string>& units) {
+    std::filesystem::path objPath = outDir;
+    std::filesystem::path exePath = outDir;
+    objPath /= progName;
+    exePath /= progName;
+    std::string objFile = objPath.string() + objExtension;
+    std::string dataFile = objPath.string() + "_literals" + objExtension;
+    // big literals are assembled from the blob next to the .cpp
+    k_13::Process data({"g++", "-c", dataStub, "-o", dataFile});
+    if (!dataStub.empty())
+        data.start();
+    // as many units at a time as there are cores
+    std::size_t jobs = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::string> unitObjects;
+    std::list<k_13::Process> running;
+    int status = 0;
+    for (auto &unit : units) {
+        std::filesystem::path unitObject = std::filesystem::path(unit).replace_extension(objExtension);
+        std::vector<std::string> compile = {"g++", "-c", unit, "-o", unitObject.string()};
+        if (runtime)
+            compile.push_back("-I" + std::string(K13RT_CPP_INCLUDE_DIR));
+        if (running.size() >= jobs) {
+            if (finish(running.front()) != 0)
+                status = -1;
+            running.pop_front();
         }
-        file.close();
+        running.emplace_back(compile);
+        running.back().start();
+        unitObjects.push_back(unitObject.string());
+    }
+    for (auto &unit : running) {
+        if (finish(unit) != 0)
+            status = -1;
     }
+    if (finish(object) != 0)
+        status = -1;
+    if (!dataStub.empty() && finish(data) != 0)
+        status = -1;
+    if (status == 0) {
+        std::vector<std::string> link = {"g++", objFile};
+        link.insert(link.end(), unitObjects.begin(), unitObjects.end());
+        if (!dataStub.empty())
+            link.push_back(dataFile);
+        if (runtime)
+            link.push_back(K13RT_CPP_LIBRARY);
+        link.push_back("-o");
+        link.push_back(exePath.string() + exeExtension);
+        k_13::Process executable(link);
+        executable.start();
+        status = finish(executable);
+    }
+    std::cout << "[INFO] G++ finish" << std::endl;
+    return status;
 }
 
-void writeLabelTable(const std::map<std::string, std::list<std::pair<int, k_13::ExpressionType>>> &labels, const std::string& outDir) {
-    k_13::constants_k13 constants;
-    std::filesystem::path outputFile = outDir;
-    outputFile /= "allLexems.txt";
-    std::ofstream file(outputFile, std::ios::app);
-    if (file.is_open()) {
-        file << "|----------------------------------------------------------------------------------------|\n";
-        file << "|                                     Labels usage                                       |\n";
-        file << "|----------------------------------------------------------------------------------------|\n";
-        file << "|   label   |   line number   |   expression type   |\n";
-        file << "|----------------------------------------------------------------------------------------|\n";
-        for (auto label : labels) {
-            for (auto line : label.second) {
-                file << "|\t" << label.first << findDistance(10, label.first) << " |\t" << line.first << findDistance(14, std::to_string(line.first)) << " |\t" << static_cast<std::underlying_type_t<k_13::ExpressionType>>(line.second) << " \t|\t";
-                file << constants.enumToStringExpressions[line.second] << findDistance(18, constants.enumToStringExpressions[line.second]) << " |\n";
-                file << "|----------------------------------------------------------------------------------------|\n";
-            }
-        }
-        file.close();
+// the program is linked with the runtime library k13c was built with. On x86-64
+// Linux that runtime is freestanding and the executable is static without libc.
+void buildC(const std::string& progName, const std::string& outDir) {
+    std::filesystem::path cPath = outDir;
+    std::filesystem::path objPath = outDir;
+    std::filesystem::path exePath = outDir;
+    cPath /= progName + ".c";
+    objPath /= progName;
+    exePath /= progName;
+    std::cout << "[INFO] Generation completed to " << cPath.string() << std::endl;
+    if (k_13::Process::find("cc").empty()) {
+        std::cout << "[WARN] cc (gcc) isn't installed in your system. To generate executive file use any C99 compiler with "
+            << K13RT_INCLUDE_DIR << "/k13rt.c and rerun k13 compiler" << std::endl;
+        return;
+    }
+    std::string objFile = objPath.string() + objExtension;
+    std::vector<std::string> compile = {"cc", "-std=c99", "-I" + std::string(K13RT_INCLUDE_DIR)};
+#if defined(__linux__) && defined(__x86_64__)
+    compile.push_back("-ffreestanding");
+    compile.push_back("-fno-stack-protector");
+    std::vector<std::string> link = {"cc", "-static", "-nostdlib"};
+#else
+    std::vector<std::string> link = {"cc"};
+#endif
+    compile.insert(compile.end(), {"-c", cPath.string(), "-o", objFile});
+    link.insert(link.end(), {objFile, K13RT_C_LIBRARY, "-o", exePath.string() + exeExtension});
+    k_13::Process object(compile);
+    object.start();
+    if (finish(object) == 0) {
+        k_13::Process executable(link);
+        executable.start();
+        finish(executable);
     }
+    std::cout << "[INFO] CC finish" << std::endl;
 }
 
-void writeVariableTable(const std::map<std::string, k_13::LexemType> &variableTable, const std::string& outDir) {
-    k_13::constants_k13 constants;
-    std::filesystem::path outputFile = outDir;
-    outputFile /= "allLexems.txt";
-    std::ofstream file(outputFile, std::ios::app);
-    if (file.is_open()) {
-        file << "|----------------------------------------------------------------------------------------|\n";
-        file << "|                                     Variables table                                     |\n";
-        file << "|----------------------------------------------------------------------------------------|\n";
-        file << "|   variable   |   type   |\n";
-        file << "|----------------------------------------------------------------------------------------|\n";
-        for (auto variable : variableTable) {
-            file << "|\t" << variable.first << findDistance(14, variable.first) << " |\t" << static_cast<std::underlying_type_t<k_13::LexemType>>(variable.second) << " \t|\t";
-            file << constants.enumToStringLexems[variable.second] << findDistance(18, constants.enumToStringLexems[variable.second]) << " |\n";
-            file << "|----------------------------------------------------------------------------------------|\n";
-        }
-        file.close();
+// no compiler runs at all, the assembly is linked with the freestanding runtime
+void buildAsm(const std::string& progName, const std::string& outDir) {
+    std::filesystem::path asmPath = outDir;
+    std::filesystem::path objPath = outDir;
+    std::filesystem::path exePath = outDir;
+    asmPath /= progName + ".s";
+    objPath /= progName + ".o";
+    exePath /= progName;
+    std::cout << "[INFO] Generation completed to " << asmPath.string() << std::endl;
+    if (k_13::Process::find("as").empty()) {
+        std::cout << "[WARN] as (binutils) isn't installed in your system. To generate executive file assemble "
+            << asmPath.string() << " and link it with " << K13RT_C_LIBRARY << std::endl;
+        return;
+    }
+    k_13::Process object({"as", asmPath.string(), "-o", objPath.string()});
+    object.start();
+    if (finish(object) == 0) {
+        k_13::Process executable({"ld", "-static", "-u", "_start", "-o", exePath.string(), objPath.string(), K13RT_C_LIBRARY});
+        executable.start();
+        finish(executable);
+    }
+    std::cout << "[INFO] AS finish" << std::endl;
+}
+
+// the program runs inside k13c on the bytecode interpreter or as machine code
+// translated from the bytecode, nothing is built
+int runBytecode(const std::vector<k_13::Keyword>& keywords, const std::vector<k_13::Literal>& literals, const k_13::GeneratorOptions& options, bool jit) {
+    k_13::BytecodeCompiler compiler;
+    k_13::BytecodeProgram program;
+    compiler.setOptions(options);
+    if (compiler.compile(keywords, literals, program) != 0) {
+        std::cerr << "[ERROR] Bytecode compilation failed: " << compiler.getError() << std::endl;
+        return -1;
+    }
+    std::ios::sync_with_stdio(false);
+    if (jit) {
+        k_13::Jit native(std::cin, std::cout);
+        return native.run(program);
     }
+    k_13::VirtualMachine machine(std::cin, std::cout);
+    return machine.run(program);
 }
 
-void writeExpressions(const std::list<std::pair<k_13::LexemType, std::vector<k_13::Lexem>>> &expressions, const std::string& outDir) {
-    std::filesystem::path outputFile = outDir;
-    outputFile /= "allLexems.txt";
-    std::ofstream file(outputFile, std::ios::app);
-    if (file.is_open()) {
-        file << "|----------------------------------------------------------------------------------------|\n";
-        file << "|                                     Expressions table                                   |\n";
-        file << "|----------------------------------------------------------------------------------------|\n";
-        file << "|   expression type   |   expression   \n";
-        file << "|----------------------------------------------------------------------------------------|\n";
-        for (auto expression : expressions) {
-            file << "|\t" << static_cast<std::underlying_type_t<k_13::LexemType>>(expression.first) << findDistance(20, std::to_string(static_cast<std::underlying_type_t<k_13::LexemType>>(expression.first))) << " |\t";
-            for (auto lexem : expression.second) {
-                file << lexem.value << " ";
+// the program starts on the interpreter at once. When it has run threshold
+// statements g++ builds a resumable version in the background, and at the
+// next safe point after the build the process is replaced by the executable,
+// which loads the variables and the unread input from a state file.
+int runTiered(const std::vector<k_13::Keyword>& keywords, const std::vector<k_13::Literal>& literals, const k_13::GeneratorOptions& options,
+    const std::string& progName, const std::string& outDir, std::uint64_t threshold) {
+#ifdef _WIN32
+    return runBytecode(keywords, literals, options, false);
+#else
+    k_13::BytecodeCompiler compiler;
+    k_13::BytecodeProgram program;
+    compiler.setOptions(options);
+    compiler.setSafePoints(true);
+    if (compiler.compile(keywords, literals, program) != 0) {
+        std::cerr << "[ERROR] Bytecode compilation failed: " << compiler.getError() << std::endl;
+        return -1;
+    }
+    // without string bounds, the state restores strings of any length
+    k_13::GeneratorOptions resumable = options;
+    resumable.resumable = true;
+    k_13::Generator generator;
+    generator.setOptions(resumable);
+    std::filesystem::path cppPath = std::filesystem::path(outDir) / (progName + "_tiered.cpp");
+    std::filesystem::path exePath = std::filesystem::path(outDir) / (progName + "_tiered");
+    std::filesystem::path statePath = std::filesystem::path(outDir) / (progName + "_tiered.state");
+    bool canBuild = generator.createCpp(keywords, progName + "_tiered", outDir, literals) == 0;
+    if (!canBuild)
+        std::cerr << "[WARN] Can't create " << cppPath.string() << ", the program stays on the interpreter" << std::endl;
+    else if (k_13::Process::find("g++").empty()) {
+        std::cerr << "[WARN] g++ (gcc) isn't installed in your system, the program stays on the interpreter" << std::endl;
+        canBuild = false;
+    }
+    std::vector<std::string> exeGenCom = {"g++", "-O2", cppPath.string()};
+    if (!generator.getDataStub().empty())
+        exeGenCom.push_back(generator.getDataStub());
+    if (resumable.runtimeLibrary)
+        exeGenCom.insert(exeGenCom.end(), {"-I" + std::string(K13RT_CPP_INCLUDE_DIR), K13RT_CPP_LIBRARY});
+    exeGenCom.insert(exeGenCom.end(), {"-o", exePath.string()});
+
+    // started at the threshold, polled at the safe points after it
+    k_13::Process build(exeGenCom);
+    bool building = false;
+    std::ios::sync_with_stdio(false);
+    k_13::VirtualMachine machine(std::cin, std::cout);
+    machine.setSafePointHandler([&](std::uint64_t statements) {
+        if (!canBuild || statements < threshold)
+            return false;
+        if (!building) {
+            std::cerr << "[INFO] Tiered: building " << exePath.string() << " after " << statements << " statements" << std::endl;
+            if (build.start() != 0) {
+                std::cerr << "[WARN] Tiered: can't start g++, the program stays on the interpreter" << std::endl;
+                canBuild = false;
             }
-            file << "|\n";
-            file << "|----------------------------------------------------------------------------------------|\n";
+            building = canBuild;
+            return false;
         }
-        file.close();
+        if (!build.finished())
+            return false;
+        if (build.getStatus() != 0) {
+            std::cerr << "[WARN] Tiered: g++ failed, the program stays on the interpreter" << std::endl;
+            canBuild = false;
+            return false;
+        }
+        return true;
+    }, threshold);
+    int status = machine.run(program);
+    if (status != 1) {
+        // the program ended first, its build isn't needed anymore
+        if (building && !build.finished()) {
+            build.kill();
+            build.wait();
+        }
+        return status;
+    }
+    std::ofstream state(statePath, std::ios::binary);
+    machine.writeState(state, program);
+    state.close();
+    if (!state) {
+        std::cerr << "[ERROR] Tiered: can't write " << statePath.string() << std::endl;
+        return -1;
     }
+    std::cout.flush();
+    std::string exe = exePath.string();
+    std::string stateFile = statePath.string();
+    char *arguments[] = {exe.data(), stateFile.data(), nullptr};
+    execv(exe.c_str(), arguments);
+    std::cerr << "[ERROR] Tiered: can't start " << exe << std::endl;
+    return -1;
+#endif
 }
 
-std::string findDistance(const int maxSize, const std::string& lexems) {
-    int length = maxSize - (lexems.length() - (lexems.length() % 8));
-    std::string distance = "";
-    int tabs = length / 8;
-    for (int i = 0; i < tabs; i++) {
-        distance += "\t";
+// finishes the dump and reports what it cost
+void closeDump(k_13::Dump& dump) {
+    if (!dump.isOpen())
+        return;
+    if (dump.close() != 0) {
+        std::cout << "[WARN] Can't write " << dump.getPath().string() << std::endl;
+        return;
     }
+    reportOutput("Dumped tables to " + dump.getPath().string(), dump.getBytes(), dump.getElapsed());
+}
 
-    return distance;
-}
\ No newline at end of file
+void reportOutput(const std::string& what, std::size_t bytes, std::chrono::steady_clock::duration elapsed) {
+    auto micros = std::max<long long>(1, std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+    std::cout << "[INFO] " << what << ": " << bytes << " bytes in " << micros << " us ("
+        << static_cast<double>(bytes) / static_cast<double>(micros) << " MB/s)" << std::endl;
+}
@@ -0,0 +1,22 @@
+#!/bin/sh
+# Times tools/append.k13, which appends one character n * 1000 times.
+# With in-place appends the time grows linearly with n.
+# Usage: tools/bench_append.sh path_to_k13c [n...]
+set -e
+
+K13C=${1:?usage: $0 path_to_k13c [n...]}
+shift
+[ $# -gt 0 ] || set -- 125 250 500 1000
+
+DIR=$(cd "$(dirname "$0")" && pwd)
+OUT=$(mktemp -d)
+trap 'rm -rf "$OUT"' EXIT
+
+"$K13C" "$DIR/append.k13" "$OUT" > /dev/null
+
+for n in "$@"; do
+    start=$(date +%s%N)
+    echo "$n" | "$OUT/append" > /dev/null
+    end=$(date +%s%N)
+    echo "$((n * 1000)) appends: $(( (end - start) / 1000000 )) ms"
+done
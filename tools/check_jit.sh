@@ -0,0 +1,45 @@
+#!/bin/sh
+# Runs every program with --jit and compares its output with the program
+# built by the C++ backend. Input is read from <program>.in when it exists
+# (a program that reads an empty input may compare uninitialized values),
+# and when <program>.out exists both outputs must also match it. The program
+# is built once more with the literals longer than a byte in the blob, which
+# must print the same as the literals pasted into the .cpp.
+# Usage: tools/check_jit.sh path_to_k13c [file.k13...]
+set -e
+
+K13C=${1:?usage: $0 path_to_k13c [file.k13...]}
+shift
+DIR=$(cd "$(dirname "$0")" && pwd)
+# by default the programs of the repository, among them string expressions,
+# literal comparisons and escape sequences (strings.k13, concat.k13, escapes.k13)
+[ $# -gt 0 ] || set -- "$DIR/../test.k13" "$DIR"/*.k13
+
+OUT=$(mktemp -d)
+trap 'rm -rf "$OUT"' EXIT
+
+failed=0
+for file in "$@"; do
+    name=$(basename "$file" .k13)
+    input=/dev/null
+    [ -f "${file%.k13}.in" ] && input="${file%.k13}.in"
+    program=$(sed -n 's/^ *program *\([A-Za-z0-9_]*\).*/\1/p' "$file" | head -n 1)
+    "$K13C" "$file" "$OUT/$name" > /dev/null 2>&1
+    "$OUT/$name/$program" < "$input" > "$OUT/$name.cpp.txt" || true
+    "$K13C" --jit "$file" "$OUT/$name" < "$input" > "$OUT/$name.jit.txt" 2> /dev/null || true
+    "$K13C" --blob-threshold=1 "$file" "$OUT/$name.blob" > /dev/null 2>&1
+    "$OUT/$name.blob/$program" < "$input" > "$OUT/$name.blob.txt" || true
+    if [ -f "${file%.k13}.out" ] && ! cmp -s "${file%.k13}.out" "$OUT/$name.cpp.txt"; then
+        echo "$name: output differs from ${file%.k13}.out"
+        failed=1
+    elif ! cmp -s "$OUT/$name.cpp.txt" "$OUT/$name.blob.txt"; then
+        echo "$name: blob output differs"
+        failed=1
+    elif cmp -s "$OUT/$name.cpp.txt" "$OUT/$name.jit.txt"; then
+        echo "$name: ok"
+    else
+        echo "$name: output differs"
+        failed=1
+    fi
+done
+exit $failed